@@ -0,0 +1,53 @@
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <csignal>
+using namespace std;
+
+#include <ping_protocol/PingProxy.h>
+using namespace ping_protocol;
+
+static volatile std::sig_atomic_t running = 1;
+static void on_signal(int) { running = 0; }
+
+int main(int argc, char** argv)
+{
+    if(argc < 4 || (std::string(argv[1]) != "udp" && std::string(argv[1]) != "serial")) {
+        cerr << "Usage : " << argv[0]
+             << " udp <ip> <port> | serial <device> <baudrate> [socket path]" << endl;
+        return 1;
+    }
+
+    auto config = PingProxy::default_proxy_config();
+    if(argc > 4) {
+        config.socketPath = argv[4];
+    }
+    PingProxy::Ptr proxy;
+    if(std::string(argv[1]) == "udp") {
+        proxy = PingProxy::CreateUDP(argv[2], std::stoul(argv[3]), config);
+    }
+    else {
+        proxy = PingProxy::CreateSerial(argv[2], std::stoul(argv[3]), config);
+    }
+    cout << "Serving " << argv[1] << ' ' << argv[2] << ' ' << argv[3]
+         << " on " << config.socketPath << endl;
+
+    std::signal(SIGINT,  on_signal);
+    std::signal(SIGTERM, on_signal);
+    for(unsigned int tick = 1; running; tick++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if(tick % 50) {
+            continue;
+        }
+        for(const auto& client : proxy->client_stats()) {
+            cout << setw(12) << client.name
+                 << (client.leaseHolder ? " [lease]" : "        ")
+                 << " priority "  << client.priority
+                 << ", forwarded " << client.forwarded
+                 << ", dropped "   << client.dropped
+                 << ", commands "  << client.commands
+                 << ", rejected "  << client.rejected << endl;
+        }
+    }
+    return 0;
+}
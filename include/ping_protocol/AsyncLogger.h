@@ -0,0 +1,80 @@
+#ifndef _DEF_PING_PROTOCOL_ASYNC_LOGGER_H_
+#define _DEF_PING_PROTOCOL_ASYNC_LOGGER_H_
+
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+#include <unistd.h>
+
+#include <ping_protocol/messages/format_utils.h>
+
+namespace ping_protocol {
+
+/**
+ * Logs messages from a background thread.
+ *
+ * log() only copies the first bytes of the frame (enough for all the fields
+ * which are formatted) into a preallocated ring and returns. Formatting and
+ * writing to the output file descriptor happen on the logger thread. If the
+ * ring is full the message is dropped and counted, the caller never blocks.
+ *
+ * log() must always be called from the same thread (single producer), which
+ * is the case when it is called from a client message_callback.
+ */
+class AsyncLogger
+{
+    public:
+
+    using Ptr      = std::shared_ptr<AsyncLogger>;
+    using ConstPtr = std::shared_ptr<const AsyncLogger>;
+
+    static constexpr unsigned int DefaultSlotCount = 1024;
+    static constexpr unsigned int DefaultSlotSize  = 256;
+
+    protected:
+
+    int       fd_;
+    LogFormat format_;
+
+    unsigned int             slotCount_;
+    unsigned int             slotSize_;
+    std::vector<uint8_t>     slots_;
+    std::vector<uint32_t>    sizes_;
+    std::atomic<uint64_t>    head_; // written by producer
+    std::atomic<uint64_t>    tail_; // written by logger thread
+    std::atomic<uint64_t>    droppedCount_;
+
+    std::vector<char>        output_;
+    std::thread              thread_;
+    std::atomic<bool>        running_;
+    std::mutex               mutex_;
+    std::condition_variable  wakeUp_;
+
+    AsyncLogger(int fd, LogFormat format,
+                unsigned int slotCount, unsigned int slotSize);
+
+    void run();
+    void write_output(std::size_t size);
+
+    public:
+
+    ~AsyncLogger();
+
+    static Ptr Create(int fd = STDOUT_FILENO,
+                      LogFormat format = LogFormat::Text,
+                      unsigned int slotCount = DefaultSlotCount,
+                      unsigned int slotSize  = DefaultSlotSize);
+
+    uint64_t dropped_count() const { return droppedCount_; }
+
+    bool log(const Message& msg);
+    bool log(const uint8_t* frame, std::size_t size);
+};
+
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_ASYNC_LOGGER_H_
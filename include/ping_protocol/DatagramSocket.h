@@ -0,0 +1,97 @@
+#ifndef _DEF_PING_PROTOCOL_DATAGRAM_SOCKET_H_
+#define _DEF_PING_PROTOCOL_DATAGRAM_SOCKET_H_
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <functional>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace ping_protocol {
+
+/**
+ * UDP transport receiving whole datagrams instead of reading the socket as a
+ * byte stream like PingClient::CreateUDP (see PingClient::CreateUDPDatagram).
+ *
+ * Datagrams are received in batches with recvmmsg into preallocated buffers
+ * and every frame contained in each datagram is validated in place before
+ * being handed to the frame callback, from the receive thread. A fatal socket
+ * error stops the receive thread and is reported to the error callback. The
+ * socket can then be recreated with reopen().
+ */
+class DatagramSocket
+{
+    public:
+
+    using Ptr      = std::shared_ptr<DatagramSocket>;
+    using ConstPtr = std::shared_ptr<const DatagramSocket>;
+
+    using FrameCallback = std::function<void(const uint8_t*, std::size_t)>;
+    using ErrorCallback = std::function<void(int)>; // errno value
+
+    static constexpr unsigned int DefaultBatchSize    = 32;
+    static constexpr unsigned int DefaultDatagramSize = 4096;
+
+    struct Statistics {
+        uint64_t syscalls;
+        uint64_t datagrams;
+        uint64_t frames;
+        uint64_t truncated;     // datagrams larger than the receive buffers
+        uint64_t skippedBytes;  // bytes not belonging to a valid frame
+    };
+
+    protected:
+
+    std::string       remoteIP_;
+    uint16_t          remotePort_;
+    int               socket_;
+    std::thread       thread_;
+    std::atomic<bool> running_;
+    FrameCallback     callback_;
+    ErrorCallback     errorCallback_;
+
+    unsigned int              batchSize_;
+    unsigned int              datagramSize_;
+    std::vector<uint8_t>      buffers_;
+    std::vector<struct iovec> iovecs_;
+    std::vector<mmsghdr>      headers_;
+
+    Statistics stats_;
+
+    DatagramSocket(const std::string& remoteIP, uint16_t remotePort,
+                   unsigned int batchSize, unsigned int datagramSize);
+
+    void open_socket();
+    void receive_loop();
+    void process_datagram(const uint8_t* data, std::size_t size);
+
+    public:
+
+    ~DatagramSocket();
+
+    static Ptr Create(const std::string& remoteIP, uint16_t remotePort,
+                      unsigned int batchSize    = DefaultBatchSize,
+                      unsigned int datagramSize = DefaultDatagramSize);
+
+    unsigned int datagram_size() const { return datagramSize_; }
+    // Not synchronized with the receive thread.
+    const Statistics& statistics() const { return stats_; }
+
+    // Returns the number of bytes sent, -1 on error (errno is set).
+    ssize_t send(const uint8_t* data, std::size_t size);
+
+    void start(const FrameCallback& callback,
+               const ErrorCallback& errorCallback = ErrorCallback());
+    void stop();
+    // Stops the receive thread and replaces the socket by a new one
+    // connected to the same remote. Not synchronized with send().
+    void reopen();
+};
+
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_DATAGRAM_SOCKET_H_
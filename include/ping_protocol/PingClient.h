@@ -2,13 +2,40 @@
 #define _DEF_PING_PROTOCOL_PING_CLIENT_H_
 
 #include <memory>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 #include <rtac_asio/Stream.h>
 
 #include <ping_protocol/messages/common.h>
+#include <ping_protocol/messages/Ping360Messages.h>
+#include <ping_protocol/DatagramSocket.h>
 
 namespace ping_protocol {
 
+/**
+ * Client for a ping device over a serial or UDP stream, or over UDP
+ * datagrams received in batches (CreateUDPDatagram, see DatagramSocket).
+ *
+ * A supervisor thread keeps the connection alive : the handshake
+ * (GeneralRequest(5) answered by a ProtocolVersion) is retried with a bounded
+ * exponential backoff, the link is declared lost on stream errors or after
+ * SupervisorConfig::linkTimeout without incoming data (keep-alive requests are
+ * sent while the device is idle), and the stream is reopened when the client
+ * was created from a stream factory (the socket is recreated in datagram
+ * mode). Once reconnected, the last
+ * ping360::Transducer configuration sent is resent from the last received
+ * angle.
+ *
+ * Nothing is received before start() is called. The Create* factories start
+ * the client; derived classes are started by their own factories, once fully
+ * constructed, and must call stop() first thing in their destructor so that
+ * message_callback is not called on a partially destroyed object.
+ */
 class PingClient
 {
     public:
@@ -16,31 +43,134 @@ class PingClient
     using Ptr      = std::shared_ptr<PingClient>;
     using ConstPtr = std::shared_ptr<const PingClient>;
 
-    using ErrorCode = rtac::asio::Stream::ErrorCode;
+    using ErrorCode     = rtac::asio::Stream::ErrorCode;
+    using StreamFactory = std::function<rtac::asio::Stream::Ptr()>;
+    using Clock         = std::chrono::steady_clock;
+
+    enum ConnectionState {
+        Disconnected,
+        Handshaking,
+        Connected
+    };
+
+    struct SupervisorConfig {
+        Clock::duration handshakeTimeout;
+        Clock::duration backoffMin;
+        Clock::duration backoffMax;
+        Clock::duration linkTimeout;       // without incoming data
+        unsigned int    handshakeAttempts; // before reopening the stream
+    };
+
+    static SupervisorConfig default_supervisor_config() {
+        SupervisorConfig res;
+        res.handshakeTimeout  = std::chrono::milliseconds(100);
+        res.backoffMin        = std::chrono::milliseconds(5);
+        res.backoffMax        = std::chrono::seconds(2);
+        res.linkTimeout       = std::chrono::seconds(1);
+        res.handshakeAttempts = 3;
+        return res;
+    }
+
+    struct ConnectionStats {
+        unsigned int    connectionCount; // successful handshakes
+        unsigned int    linkLossCount;
+        unsigned int    reopenCount;
+        Clock::duration lastTimeToConnect;   // from link loss to handshake
+        Clock::duration lastTimeToFirstPing; // from link loss to first DeviceData
+    };
 
     protected:
 
+    StreamFactory           streamFactory_;
     rtac::asio::Stream::Ptr stream_;
-    ProtocolVersion protocolVersion_;
+    DatagramSocket::Ptr     datagram_;    // replaces stream_ in datagram mode
+    std::mutex              streamMutex_; // protects stream_ and generation_
+    unsigned int            generation_;  // incremented each time stream_ is replaced
+    bool                    readPending_;
+    std::mutex              writeMutex_;  // serializes send()
+
+    mutable std::mutex versionMutex_;
+    ProtocolVersion    protocolVersion_;
 
     MessageHeader incomingHeader_;
     Message       incomingMessage_;
 
-    PingClient(rtac::asio::Stream::Ptr stream);
+    SupervisorConfig             config_;
+    std::atomic<ConnectionState> state_;
+    std::atomic<Clock::rep>      lastActivity_;
+    std::atomic<bool>            waitingFirstPing_;
+    std::atomic<bool>            keepAlivePending_;
+    std::atomic<int>             lastAngle_;
+
+    std::thread             supervisor_;
+    std::mutex              supervisorMutex_;
+    std::condition_variable supervisorWakeUp_;
+    bool                    running_;
+    bool                    stopped_;
+    bool                    reopenNeeded_;
+    bool                    restorePending_;
+    unsigned int            failedHandshakes_;
+    Clock::duration         backoff_;
+    Clock::time_point       nextAttempt_;
+    Clock::time_point       handshakeDeadline_;
+    Clock::time_point       lastKeepAlive_;
+    Clock::time_point       lossTime_;
+    ConnectionStats         stats_;
+
+    std::mutex                  configMutex_;
+    bool                        hasTransducerConfig_;
+    ping360::Transducer::Config transducerConfig_;
 
-    void initiate_callback(const ErrorCode& err, std::size_t byteCount);
-    void get_header();
-    void header_callback(const ErrorCode& err, std::size_t byteCount);
-    void payload_callback(const ErrorCode& err, std::size_t byteCount);
+    PingClient(rtac::asio::Stream::Ptr stream);
+    PingClient(const StreamFactory& streamFactory);
+    PingClient(const DatagramSocket::Ptr& socket);
+
+    void init_supervisor();
+    void supervise();
+    void reopen_stream();
+    void start_handshake(Clock::time_point now);
+    void send_request(const Message& msg);
+    void restore_state();
+    void link_lost(unsigned int generation, const char* reason);
+    void connected();
+    void mark_activity();
+
+    void get_header(unsigned int generation);
+    void header_callback(unsigned int generation,
+                         const ErrorCode& err, std::size_t byteCount);
+    void payload_callback(unsigned int generation,
+                          const ErrorCode& err, std::size_t byteCount);
+    void start_datagram(unsigned int generation);
+    void datagram_callback(const uint8_t* frame, std::size_t size);
+    void datagram_error(unsigned int generation, int err);
+    void dispatch(const Message& msg);
 
     public:
 
+    virtual ~PingClient();
+
     static Ptr CreateUDP(const std::string& remoteIP, uint16_t remotePort);
     static Ptr CreateSerial(const std::string& device, unsigned int baudrate);
+    static Ptr CreateUDPDatagram(const std::string& remoteIP, uint16_t remotePort,
+                                 unsigned int batchSize    = DatagramSocket::DefaultBatchSize,
+                                 unsigned int datagramSize = DatagramSocket::DefaultDatagramSize);
+
+    // stop() is final : the stream is released and nothing is received
+    // anymore. Both are idempotent.
+    void start();
+    void stop();
 
     void send(const Message& msg);
 
     void initiate_connection();
+    ConnectionState state() const { return state_; }
+    ProtocolVersion protocol_version() const;
+
+    void set_supervisor_config(const SupervisorConfig& config);
+    ConnectionStats connection_stats();
+    // nullptr unless created with CreateUDPDatagram.
+    DatagramSocket::ConstPtr datagram_socket() const { return datagram_; }
+
     virtual void message_callback(const Message& msg) const;
 };
 
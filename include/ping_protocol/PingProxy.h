@@ -0,0 +1,143 @@
+#ifndef _DEF_PING_PROTOCOL_PING_PROXY_H_
+#define _DEF_PING_PROTOCOL_PING_PROXY_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <ping_protocol/PingClient.h>
+#include <ping_protocol/ProxyProtocol.h>
+
+namespace ping_protocol {
+
+/**
+ * Shares a single device link between several local processes.
+ *
+ * The proxy owns the device through PingClient and forwards every frame it
+ * receives, unmodified and from the same buffer, to each client subscribed on
+ * a Unix datagram socket (see ProxyClient). Each client is served from its
+ * own socket, so the frames queued for a client are charged to a send buffer
+ * of its own (ProxyConfig::clientBufferSize). Sends are non-blocking : a
+ * client not reading fast enough loses frames (counted in its statistics) but
+ * never delays the device link or the other clients.
+ *
+ * Commands sent by clients are arbitrated with a lease. The client which
+ * holds the lease may send any command, which renews the lease. Another
+ * client gets the lease when it is released, when it expired (no command for
+ * ProxyConfig::leaseDuration), or when its priority is higher than the one of
+ * the holder. Rejected commands are answered with a NotAcknowledged. General
+ * requests are always forwarded and the handshake request is answered by the
+ * proxy itself.
+ */
+class PingProxy : public PingClient
+{
+    public:
+
+    using Ptr      = std::shared_ptr<PingProxy>;
+    using ConstPtr = std::shared_ptr<const PingProxy>;
+
+    struct ProxyConfig {
+        std::string     socketPath;
+        Clock::duration leaseDuration;
+        unsigned int    maxClients;
+        int             clientBufferSize; // bytes queued per client
+        unsigned int    batchSize;        // datagrams per recvmmsg call
+        unsigned int    datagramSize;
+    };
+
+    static ProxyConfig default_proxy_config() {
+        ProxyConfig res;
+        res.socketPath    = DefaultProxySocket;
+        res.leaseDuration = std::chrono::seconds(2);
+        res.maxClients       = 32;
+        res.clientBufferSize = 1 << 20;
+        res.batchSize        = 16;
+        res.datagramSize     = 4096;
+        return res;
+    }
+
+    struct ClientStats {
+        std::string name;
+        int         priority;
+        bool        leaseHolder;
+        uint64_t    forwarded; // frames sent to the client
+        uint64_t    dropped;   // frames dropped because the client was too slow
+        uint64_t    commands;  // commands forwarded to the device
+        uint64_t    rejected;  // commands rejected by the lease policy
+    };
+
+    protected:
+
+    struct Client {
+        int         socket;  // connected to the client
+        sockaddr_un address;
+        socklen_t   addressLength;
+        std::string name;
+        int         priority;
+        uint64_t    forwarded;
+        uint64_t    dropped;
+        uint64_t    commands;
+        uint64_t    rejected;
+        bool        disconnected; // socket closed, removed by the receive thread
+    };
+
+    ProxyConfig       proxyConfig_;
+    int               socket_;
+    std::thread       proxyThread_;
+    std::atomic<bool> proxyRunning_;
+
+    // Written by the receive thread, read by the device callbacks.
+    mutable std::mutex          clientsMutex_;
+    mutable std::vector<Client> clients_;
+    int                         leaseHolder_; // index in clients_, -1 if none
+    Clock::time_point           leaseExpiry_;
+
+    std::vector<uint8_t>      buffers_;
+    std::vector<struct iovec> iovecs_;
+    std::vector<sockaddr_un>  addresses_;
+    std::vector<mmsghdr>      headers_;
+    Message                   command_;
+
+    PingProxy(const StreamFactory& streamFactory, const ProxyConfig& config);
+
+    void receive_loop();
+    void process_datagram(const sockaddr_un& address, socklen_t addressLength,
+                          const uint8_t* data, std::size_t size);
+    void process_control(const sockaddr_un& address, socklen_t addressLength,
+                         const ProxyControl& control);
+    void process_command(int client, const uint8_t* frame, std::size_t size);
+    bool acquire_lease(int client);
+    int  find_client(const sockaddr_un& address, socklen_t addressLength) const;
+    int  add_client(const sockaddr_un& address, socklen_t addressLength);
+    void remove_client(int client);
+    void remove_disconnected();
+    void reply(int client, const Message& msg);
+
+    public:
+
+    ~PingProxy();
+
+    static Ptr CreateUDP(const std::string& remoteIP, uint16_t remotePort,
+                         const ProxyConfig& config = default_proxy_config());
+    static Ptr CreateSerial(const std::string& device, unsigned int baudrate,
+                            const ProxyConfig& config = default_proxy_config());
+
+    const ProxyConfig& proxy_config() const { return proxyConfig_; }
+    std::vector<ClientStats> client_stats() const;
+
+    // Stops the device link, then the client socket.
+    void stop();
+
+    // Fan-out to the clients.
+    virtual void message_callback(const Message& msg) const;
+};
+
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_PING_PROXY_H_
@@ -0,0 +1,117 @@
+#ifndef _DEF_PING_PROTOCOL_PROXY_CLIENT_H_
+#define _DEF_PING_PROTOCOL_PROXY_CLIENT_H_
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <ping_protocol/messages/common.h>
+#include <ping_protocol/ProxyProtocol.h>
+
+namespace ping_protocol {
+
+/**
+ * Client of a PingProxy, used like a PingClient.
+ *
+ * The client socket is bound to an abstract address (nothing to clean up on
+ * the filesystem) and connected to the proxy socket dedicated to this client
+ * once subscribed. Each datagram received from the proxy holds a single frame
+ * which is validated and handed to message_callback without being copied.
+ * Commands rejected by the proxy lease policy are answered by a
+ * NotAcknowledged.
+ *
+ * The subscription and handshake are retried from the receive thread with a
+ * bounded exponential backoff until the proxy answers. Once connected, the
+ * link is checked with keep-alive requests while no frame is received and the
+ * client subscribes again when the proxy stops answering (proxy restarted or
+ * device link down). Handshake and keep-alive answers are not forwarded to
+ * message_callback.
+ *
+ * Derived classes must call stop() first thing in their destructor, the
+ * receive thread calls message_callback.
+ */
+class ProxyClient
+{
+    public:
+
+    using Ptr      = std::shared_ptr<ProxyClient>;
+    using ConstPtr = std::shared_ptr<const ProxyClient>;
+
+    static constexpr unsigned int DefaultDatagramSize = 4096;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct RetryConfig {
+        Clock::duration backoffMin;
+        Clock::duration backoffMax;
+        Clock::duration linkTimeout; // without incoming datagram
+    };
+
+    static RetryConfig default_retry_config() {
+        RetryConfig res;
+        res.backoffMin  = std::chrono::milliseconds(100);
+        res.backoffMax  = std::chrono::seconds(2);
+        res.linkTimeout = std::chrono::seconds(1);
+        return res;
+    }
+
+    protected:
+
+    int               socket_;
+    sockaddr_un       proxyAddress_;
+    int               priority_;
+    std::thread       thread_;
+    std::atomic<bool> running_;
+    std::atomic<bool> connected_;
+    std::atomic<bool> keepAlivePending_;
+
+    Message            incomingMessage_; // datagrams are received in place
+    mutable std::mutex versionMutex_;
+    ProtocolVersion    protocolVersion_;
+
+    std::mutex        retryMutex_; // protects the retry state below
+    RetryConfig       retryConfig_;
+    Clock::duration   backoff_;
+    Clock::time_point nextAttempt_;
+    Clock::time_point lastKeepAlive_;
+    Clock::time_point lastActivity_; // receive thread only
+
+    ProxyClient(const std::string& socketPath, int priority,
+                unsigned int datagramSize);
+
+    void receive_loop();
+    void supervise(Clock::time_point now);
+    void subscribe();
+    void send_control(ProxyControl::Request request);
+    void send_datagram(const void* data, std::size_t size);
+
+    public:
+
+    virtual ~ProxyClient();
+
+    static Ptr Create(const std::string& socketPath = DefaultProxySocket,
+                      int priority = 0,
+                      unsigned int datagramSize = DefaultDatagramSize);
+
+    bool is_connected() const { return connected_; }
+    ProtocolVersion protocol_version() const;
+
+    void set_retry_config(const RetryConfig& config);
+
+    void send(const Message& msg);
+    void release_lease();
+
+    void initiate_connection();
+    void stop();
+    virtual void message_callback(const Message& msg) const;
+};
+
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_PROXY_CLIENT_H_
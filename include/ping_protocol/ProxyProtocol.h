@@ -0,0 +1,60 @@
+#ifndef _DEF_PING_PROTOCOL_PROXY_PROTOCOL_H_
+#define _DEF_PING_PROTOCOL_PROXY_PROTOCOL_H_
+
+#include <cstdint>
+#include <cstring>
+
+namespace ping_protocol {
+
+/**
+ * Datagrams exchanged between PingProxy and its clients over a Unix datagram
+ * socket.
+ *
+ * Device frames and client commands are sent as-is, one ping-protocol frame
+ * per datagram. A datagram starting with ProxyControl::Magic instead of the
+ * 'BR' frame start is a control request from a client to the proxy.
+ *
+ * The proxy answers a Subscribe from the socket dedicated to the client. The
+ * client connects to the source address of this answer and keeps sending its
+ * requests to the proxy socket.
+ */
+
+constexpr const char* DefaultProxySocket = "/tmp/ping_proxy.sock";
+
+#pragma pack(push, 1)
+
+struct ProxyControl
+{
+    static constexpr uint32_t Magic = 0x59585250; // "PRXY"
+
+    enum Request : uint8_t {
+        Subscribe    = 1, // registers the client and sets its priority
+        Unsubscribe  = 2,
+        ReleaseLease = 3, // gives back command rights on the device
+    };
+
+    uint32_t magic;
+    uint8_t  request;
+    uint8_t  reserved[3];
+    int32_t  priority;
+
+    ProxyControl(Request req = Subscribe, int32_t prio = 0) {
+        std::memset(this, 0, sizeof(ProxyControl));
+        magic    = Magic;
+        request  = req;
+        priority = prio;
+    }
+
+    static bool is_control(const uint8_t* data, std::size_t size) {
+        uint32_t m;
+        if(size < sizeof(ProxyControl)) return false;
+        std::memcpy(&m, data, sizeof(m));
+        return m == Magic;
+    }
+};
+
+#pragma pack(pop)
+
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_PROXY_PROTOCOL_H_
@@ -0,0 +1,70 @@
+#ifndef _DEF_PING_PROTOCOL_SHARED_PUBLISHER_H_
+#define _DEF_PING_PROTOCOL_SHARED_PUBLISHER_H_
+
+#include <memory>
+#include <string>
+
+#include <ping_protocol/SharedRing.h>
+
+namespace ping_protocol {
+
+/**
+ * Publishes messages and assembled sweeps into a POSIX shared memory ring.
+ *
+ * The publisher never waits for readers : slow readers are overwritten and
+ * detect it through the slot sequence counters. Adding readers costs nothing
+ * on the publisher side.
+ *
+ * The shared memory object is created by the publisher and removed by its
+ * destructor. Creation fails if the object already exists : it belongs to a
+ * running publisher, or was left by one which crashed and must be removed
+ * (shm_unlink, or rm /dev/shm/<name>) before publishing again.
+ */
+class SharedPublisher
+{
+    public:
+
+    using Ptr      = std::shared_ptr<SharedPublisher>;
+    using ConstPtr = std::shared_ptr<const SharedPublisher>;
+
+    static constexpr uint32_t DefaultSlotCount = 64;
+    // large enough for a 400x1200 sweep
+    static constexpr uint32_t DefaultSlotSize  = 1 << 19;
+
+    protected:
+
+    std::string       name_;
+    std::size_t       mappedSize_;
+    SharedRingHeader* header_;
+    uint8_t*          slots_;
+
+    SharedPublisher(const std::string& name, uint32_t slotCount, uint32_t slotSize);
+
+    SharedSlotHeader* begin_record(uint32_t kind, std::size_t size, uint64_t& index);
+    void end_record(SharedSlotHeader* slot, uint64_t index);
+
+    public:
+
+    ~SharedPublisher();
+
+    static Ptr Create(const std::string& name,
+                      uint32_t slotCount = DefaultSlotCount,
+                      uint32_t slotSize  = DefaultSlotSize);
+
+    const std::string& name() const { return name_; }
+    uint32_t slot_count() const { return header_->slot_count; }
+    uint32_t slot_size()  const { return header_->slot_size; }
+    std::size_t max_record_size() const {
+        return header_->slot_size - sizeof(SharedSlotHeader);
+    }
+    uint64_t published_count() const {
+        return header_->head.load(std::memory_order_relaxed);
+    }
+
+    void publish(const Message& msg);
+    void publish(const ping360::Sweep& sweep);
+};
+
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_SHARED_PUBLISHER_H_
@@ -0,0 +1,98 @@
+#ifndef _DEF_PING_PROTOCOL_SHARED_READER_H_
+#define _DEF_PING_PROTOCOL_SHARED_READER_H_
+
+#include <memory>
+#include <string>
+
+#include <ping_protocol/SharedRing.h>
+
+namespace ping_protocol {
+
+/**
+ * Read-only view on a record of a shared memory ring.
+ *
+ * The view points directly into the shared memory segment. The publisher may
+ * overwrite the record at any time : data read through the view must be
+ * considered valid only if is_valid() still returns true after it was used.
+ */
+struct SharedRecordView
+{
+    const SharedSlotHeader* slot;
+    uint64_t                index;
+    uint32_t                kind;
+    uint32_t                size;
+    const uint8_t*          data;
+
+    bool is_valid() const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot->sequence.load(std::memory_order_relaxed) == 2*(index + 1);
+    }
+
+    // RecordMessage accessors
+    const MessageHeader& message_header() const {
+        return *reinterpret_cast<const MessageHeader*>(data);
+    }
+    const uint8_t* message_payload() const {
+        return data + sizeof(MessageHeader);
+    }
+
+    // RecordSweep accessors
+    const SharedSweepHeader& sweep_header() const {
+        return *reinterpret_cast<const SharedSweepHeader*>(data);
+    }
+    const uint8_t* sweep_data() const {
+        return data + sizeof(SharedSweepHeader);
+    }
+    const uint8_t* sweep_row(unsigned int angle) const {
+        return this->sweep_data()
+             + this->sweep_header().sample_count*(angle % ping360::Sweep::AngleCount);
+    }
+};
+
+/**
+ * Reads records from a shared memory ring written by a SharedPublisher.
+ *
+ * Each reader maps the segment read-only and keeps its own cursor. Records
+ * overwritten before the reader got to them are skipped and counted in
+ * dropped_count().
+ */
+class SharedReader
+{
+    public:
+
+    using Ptr      = std::shared_ptr<SharedReader>;
+    using ConstPtr = std::shared_ptr<const SharedReader>;
+
+    protected:
+
+    std::string             name_;
+    std::size_t             mappedSize_;
+    const SharedRingHeader* header_;
+    const uint8_t*          slots_;
+    uint64_t                cursor_;
+    uint64_t                droppedCount_;
+
+    SharedReader(const std::string& name);
+
+    public:
+
+    ~SharedReader();
+
+    static Ptr Create(const std::string& name);
+
+    const std::string& name() const { return name_; }
+    uint32_t slot_count() const { return header_->slot_count; }
+    uint64_t head() const {
+        return header_->head.load(std::memory_order_acquire);
+    }
+    uint64_t cursor() const { return cursor_; }
+    uint64_t dropped_count() const { return droppedCount_; }
+
+    bool read(uint64_t index, SharedRecordView& view) const;
+    bool next(SharedRecordView& view);
+    bool latest(SharedRecordView& view) const;
+};
+
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_SHARED_READER_H_
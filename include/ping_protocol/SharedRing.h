@@ -0,0 +1,64 @@
+#ifndef _DEF_PING_PROTOCOL_SHARED_RING_H_
+#define _DEF_PING_PROTOCOL_SHARED_RING_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include <ping_protocol/messages/Ping360Messages.h>
+#include <ping_protocol/ping360/Sweep.h>
+
+namespace ping_protocol {
+
+// Memory layout of the shared memory ring written by SharedPublisher and read
+// by SharedReader.
+//
+// The segment starts with a SharedRingHeader followed by slot_count slots of
+// slot_size bytes each. Each slot starts with a SharedSlotHeader followed by
+// the record payload. There is a single writer. Each slot is protected by its
+// own sequence counter (seqlock) : the sequence is odd while the slot is being
+// written and equals 2*(index + 1) once record number index is readable.
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+              "SharedRing needs lock-free 64 bits atomics to work across processes");
+
+enum SharedRecordKind : uint32_t {
+    RecordNone    = 0,
+    RecordMessage = 1, // a raw ping protocol frame (header, payload, checksum)
+    RecordSweep   = 2, // a SharedSweepHeader followed by the polar sweep data
+};
+
+struct SharedRingHeader
+{
+    static constexpr uint32_t Magic   = 0x50524e47; // "PRNG"
+    static constexpr uint32_t Version = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    alignas(64) std::atomic<uint64_t> head; // number of records published so far
+};
+
+struct alignas(64) SharedSlotHeader
+{
+    std::atomic<uint64_t> sequence;
+    uint32_t              kind;
+    uint32_t              size; // payload size in bytes
+};
+
+struct SharedSweepHeader
+{
+    ping360::PingParameters parameters;
+    uint16_t sample_count;
+    uint16_t row_count;
+    uint8_t  filled[ping360::Sweep::AngleCount];
+};
+
+inline std::size_t shared_ring_size(uint32_t slotCount, uint32_t slotSize)
+{
+    return sizeof(SharedRingHeader) + ((std::size_t)slotCount)*slotSize;
+}
+
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_SHARED_RING_H_
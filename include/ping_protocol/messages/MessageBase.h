@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <cstring>
+#include <sstream>
+#include <vector>
 
 namespace ping_protocol {
 
@@ -118,25 +120,18 @@ struct Message
 
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::MessageHeader& header)
 {
-    os << "payload_length : " << header.payload_length << std::endl
-       << "message_id     : " << header.message_id;
+    os << "payload_length : " << header.payload_length
+       << "\nmessage_id     : " << header.message_id;
     return os;
 }
 
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::Message& msg)
 {
-    os << "ping_protocol::Message :" << std::endl;
-    {
-        os << "  header :";
-        std::ostringstream oss;
-        oss << msg.header();
-        std::istringstream iss(oss.str());
-        std::string line;
-        for(; std::getline(iss, line); ) {
-            os << "\n  - " << line;
-        }
-    }
-    os << std::endl << "  checksum : " << msg.checksum();
+    os << "ping_protocol::Message :"
+       << "\n  header :"
+       << "\n  - payload_length : " << msg.header().payload_length
+       << "\n  - message_id     : " << msg.header().message_id
+       << "\n  checksum : " << msg.checksum();
 
     return os;
 }
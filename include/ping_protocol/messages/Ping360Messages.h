@@ -159,6 +159,26 @@ struct MotorOff : public Message
 } //namespace ping360
 } //namespace ping_protocol
 
+namespace ping_protocol { namespace ping360 {
+
+// Writes one field per line, each line starting with linePrefix.
+inline std::ostream& print_ping_parameters(std::ostream& os,
+                                           const PingParameters& params,
+                                           const char* linePrefix)
+{
+    os << linePrefix << "mode               : " << (unsigned int)params.mode
+       << linePrefix << "gain_setting       : " << (unsigned int)params.gain_setting
+       << linePrefix << "angle              : " << params.angle
+       << linePrefix << "transmit_duration  : " << params.transmit_duration
+       << linePrefix << "sample_period      : " << params.sample_period
+       << linePrefix << "transmit_frequency : " << params.transmit_frequency
+       << linePrefix << "number_of_samples  : " << params.number_of_samples;
+    return os;
+}
+
+} //namespace ping360
+} //namespace ping_protocol
+
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::ping360::PingParameters& params)
 {
     os <<   "mode               : " << (unsigned int)params.mode
@@ -173,7 +193,7 @@ inline std::ostream& operator<<(std::ostream& os, const ping_protocol::ping360::
 
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::ping360::SetPing360Id& msg)
 {
-    os << "ping360::SetPing360Id :" << std::endl
+    os << "ping360::SetPing360Id :" << '\n'
        << "  - device_id : " << msg.device_id();
     return os;
 }
@@ -181,41 +201,29 @@ inline std::ostream& operator<<(std::ostream& os, const ping_protocol::ping360::
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::ping360::DeviceData& msg)
 {
     os << "ping360::DeviceData :";
-    std::ostringstream oss;
-    oss << msg.ping_parameters()
-        << "\ndata_length        : " << msg.metadata().data_length;
-    std::istringstream iss(oss.str());
-    std::string line;
-    for(; std::getline(iss, line); ) {
-        os << "\n  - " << line;
-    }
+    ping_protocol::ping360::print_ping_parameters(os, msg.ping_parameters(), "\n  - ")
+        << "\n  - data_length        : " << msg.metadata().data_length;
     return os;
 }
 
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::ping360::Transducer& msg)
 {
     os << "ping360::Transducer :";
-    std::ostringstream oss;
-    oss << msg.ping_parameters()
-        << "\ntransmit           : " << (unsigned int)msg.config().transmit;
-    std::istringstream iss(oss.str());
-    std::string line;
-    for(; std::getline(iss, line); ) {
-        os << "\n  - " << line;
-    }
+    ping_protocol::ping360::print_ping_parameters(os, msg.ping_parameters(), "\n  - ")
+        << "\n  - transmit           : " << (unsigned int)msg.config().transmit;
     return os;
 }
 
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::ping360::Reset& msg)
 {
-    os << "ping360::Reset :" << std::endl
+    os << "ping360::Reset :" << '\n'
        << "  - run_bootloader : " << msg.run_bootloader();
     return os;
 }
 
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::ping360::MotorOff& msg)
 {
-    os << "ping360::MotorOff" << std::endl;
+    os << "ping360::MotorOff" << '\n';
     return os;
 }
 
@@ -202,14 +202,14 @@ inline std::ostream& operator<<(std::ostream& os, const ping_protocol::PingDevic
 
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::Acknowledged& msg)
 {
-    os << "ping_protocol::Acknowledged :" << std::endl
+    os << "ping_protocol::Acknowledged :" << '\n'
        << "  - acked_id : " << msg.acked_id();
     return os;
 }
 
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::NotAcknowledged& msg)
 {
-    os << "ping_protocol::NotAcknowledged :" << std::endl
+    os << "ping_protocol::NotAcknowledged :" << '\n'
        << "  - nacked_id : " << msg.nacked_id()
        << "  - message   : " << msg.nack_message();
     return os;
@@ -217,28 +217,28 @@ inline std::ostream& operator<<(std::ostream& os, const ping_protocol::NotAcknow
 
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::AsciiMessage& msg)
 {
-    os << "ping_protocol::AsciiMessage :" << std::endl
+    os << "ping_protocol::AsciiMessage :" << '\n'
        << "  - message   : " << msg.ascii_message();
     return os;
 }
 
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::GeneralRequest& msg)
 {
-    os << "ping_protocol::GeneralRequest :" << std::endl
+    os << "ping_protocol::GeneralRequest :" << '\n'
        << "  - requested_id : " << msg.requested_id();
     return os;
 }
 
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::ProtocolVersion& msg)
 {
-    os << "ping_protocol::ProtocolVersion :" << std::endl
+    os << "ping_protocol::ProtocolVersion :" << '\n'
        << "  - version : " << msg.version();
     return os;
 }
 
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::DeviceInformation& msg)
 {
-    os << "ping_protocol::ProtocolVersion :" << std::endl
+    os << "ping_protocol::ProtocolVersion :" << '\n'
        << "  - device_type      : " << msg.information().device_type
        << "  - device revision  : " << (unsigned int)msg.information().device_revision
        << "  - firmware_version : " << msg.information().firmware_version;
@@ -247,7 +247,7 @@ inline std::ostream& operator<<(std::ostream& os, const ping_protocol::DeviceInf
 
 inline std::ostream& operator<<(std::ostream& os, const ping_protocol::SetDeviceId& msg)
 {
-    os << "ping_protocol::SetDeviceId :" << std::endl
+    os << "ping_protocol::SetDeviceId :" << '\n'
        << "  - device_id : " << msg.device_id();
     return os;
 }
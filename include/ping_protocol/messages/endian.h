@@ -0,0 +1,58 @@
+#ifndef _DEF_PING_PROTOCOL_MESSAGES_ENDIAN_H_
+#define _DEF_PING_PROTOCOL_MESSAGES_ENDIAN_H_
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace ping_protocol {
+
+// The ping protocol is little-endian. On little-endian hosts these compile to
+// a single (possibly unaligned) load or store.
+
+namespace detail {
+
+inline uint8_t  byteswap(uint8_t  v) { return v; }
+inline uint16_t byteswap(uint16_t v) { return __builtin_bswap16(v); }
+inline uint32_t byteswap(uint32_t v) { return __builtin_bswap32(v); }
+inline uint64_t byteswap(uint64_t v) { return __builtin_bswap64(v); }
+
+template <std::size_t Size> struct UnsignedOfSize {};
+template <> struct UnsignedOfSize<1> { using type = uint8_t;  };
+template <> struct UnsignedOfSize<2> { using type = uint16_t; };
+template <> struct UnsignedOfSize<4> { using type = uint32_t; };
+template <> struct UnsignedOfSize<8> { using type = uint64_t; };
+
+} //namespace detail
+
+template <typename T>
+inline T load_le(const uint8_t* data)
+{
+    static_assert(std::is_arithmetic<T>::value, "load_le only loads arithmetic types");
+    using U = typename detail::UnsignedOfSize<sizeof(T)>::type;
+    U bits;
+    std::memcpy(&bits, data, sizeof(U));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    bits = detail::byteswap(bits);
+#endif
+    T value;
+    std::memcpy(&value, &bits, sizeof(T));
+    return value;
+}
+
+template <typename T>
+inline void store_le(uint8_t* data, T value)
+{
+    static_assert(std::is_arithmetic<T>::value, "store_le only stores arithmetic types");
+    using U = typename detail::UnsignedOfSize<sizeof(T)>::type;
+    U bits;
+    std::memcpy(&bits, &value, sizeof(T));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    bits = detail::byteswap(bits);
+#endif
+    std::memcpy(data, &bits, sizeof(U));
+}
+
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_MESSAGES_ENDIAN_H_
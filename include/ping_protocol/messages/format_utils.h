@@ -0,0 +1,400 @@
+#ifndef _DEF_PING_PROTOCOL_MESSAGES_FORMAT_UTILS_H_
+#define _DEF_PING_PROTOCOL_MESSAGES_FORMAT_UTILS_H_
+
+#include <cstring>
+#include <cstdint>
+
+#include <ping_protocol/messages/message_types.h>
+
+namespace ping_protocol {
+
+// Formatting of messages into caller provided buffers. Unlike the
+// std::ostream operators, nothing here allocates memory. Messages are
+// formatted on a single line, either as text or as JSON.
+
+enum class LogFormat {
+    Text,
+    Json
+};
+
+/**
+ * Writes characters into a fixed size buffer. Output which does not fit is
+ * dropped and truncated() becomes true.
+ */
+class FormatBuffer
+{
+    protected:
+
+    char* begin_;
+    char* end_;
+    char* cursor_;
+    bool  truncated_;
+
+    public:
+
+    FormatBuffer(char* data, std::size_t size) :
+        begin_(data), end_(data + size), cursor_(data), truncated_(false)
+    {}
+
+    std::size_t size() const { return cursor_ - begin_; }
+    std::size_t capacity() const { return end_ - begin_; }
+    bool truncated() const { return truncated_; }
+
+    FormatBuffer& put(char c) {
+        if(cursor_ < end_) *(cursor_++) = c;
+        else truncated_ = true;
+        return *this;
+    }
+    FormatBuffer& put(const char* str, std::size_t count) {
+        std::size_t available = end_ - cursor_;
+        if(count > available) {
+            count = available;
+            truncated_ = true;
+        }
+        std::memcpy(cursor_, str, count);
+        cursor_ += count;
+        return *this;
+    }
+    FormatBuffer& put(const char* str) {
+        return this->put(str, std::strlen(str));
+    }
+    FormatBuffer& put(uint64_t value) {
+        char digits[20];
+        int n = sizeof(digits);
+        do {
+            digits[--n] = '0' + value % 10;
+            value /= 10;
+        } while(value);
+        return this->put(digits + n, sizeof(digits) - n);
+    }
+    FormatBuffer& put(int64_t value) {
+        if(value < 0) {
+            this->put('-');
+            return this->put((uint64_t)(-(value + 1)) + 1);
+        }
+        return this->put((uint64_t)value);
+    }
+    FormatBuffer& put(uint32_t value) { return this->put((uint64_t)value); }
+    FormatBuffer& put(uint16_t value) { return this->put((uint64_t)value); }
+    FormatBuffer& put(uint8_t  value) { return this->put((uint64_t)value); }
+
+    // str may not be null terminated, stops at the first null character.
+    FormatBuffer& put_json_string(const char* str, std::size_t count) {
+        static const char hex[] = "0123456789abcdef";
+        this->put('"');
+        for(std::size_t n = 0; n < count && str[n] != '\0'; n++) {
+            char c = str[n];
+            if(c == '"' || c == '\\') {
+                this->put('\\').put(c);
+            }
+            else if((unsigned char)c < 0x20) {
+                this->put("\\u00", 4).put(hex[(c >> 4) & 0xf]).put(hex[c & 0xf]);
+            }
+            else {
+                this->put(c);
+            }
+        }
+        return this->put('"');
+    }
+
+    // Same as put_json_string with C escapes : \" \\ \n \r \t and \xNN.
+    FormatBuffer& put_text_string(const char* str, std::size_t count) {
+        static const char hex[] = "0123456789abcdef";
+        this->put('"');
+        for(std::size_t n = 0; n < count && str[n] != '\0'; n++) {
+            char c = str[n];
+            switch(c) {
+                case '"':
+                case '\\': this->put('\\').put(c); break;
+                case '\n': this->put("\\n", 2); break;
+                case '\r': this->put("\\r", 2); break;
+                case '\t': this->put("\\t", 2); break;
+                default:
+                    if((unsigned char)c < 0x20) {
+                        this->put("\\x", 2).put(hex[(c >> 4) & 0xf]).put(hex[c & 0xf]);
+                    }
+                    else {
+                        this->put(c);
+                    }
+                    break;
+            }
+        }
+        return this->put('"');
+    }
+};
+
+/**
+ * Field writers used by format_fields. TextFields writes
+ * "name field=value ...", JsonFields writes {"type":"name","field":value}.
+ */
+struct TextFields
+{
+    FormatBuffer& buffer;
+
+    void begin(const char* name) { buffer.put(name); }
+    template <typename T>
+    void field(const char* name, T value) {
+        buffer.put(' ').put(name).put('=').put(value);
+    }
+    void string_field(const char* name, const char* str, std::size_t count) {
+        buffer.put(' ').put(name).put('=').put_text_string(str, count);
+    }
+    void end() { buffer.put('\n'); }
+};
+
+struct JsonFields
+{
+    FormatBuffer& buffer;
+    std::size_t   reserve  = 0; // room kept after complete
+    std::size_t   complete = 0; // size up to the last field written entirely
+
+    void begin(const char* name) {
+        buffer.put("{\"type\":\"").put(name).put('"');
+        this->field_done();
+    }
+    template <typename T>
+    void field(const char* name, T value) {
+        buffer.put(",\"").put(name).put("\":", 2).put(value);
+        this->field_done();
+    }
+    void string_field(const char* name, const char* str, std::size_t count) {
+        buffer.put(",\"").put(name).put("\":", 2).put_json_string(str, count);
+        this->field_done();
+    }
+    void end() { buffer.put("}\n", 2); }
+
+    void field_done() {
+        if(!buffer.truncated() && buffer.size() + reserve <= buffer.capacity())
+            complete = buffer.size();
+    }
+};
+
+template <class Fields>
+inline void format_ping_parameters(Fields& f, const ping360::PingParameters& params)
+{
+    f.field("mode",               params.mode);
+    f.field("gain_setting",       params.gain_setting);
+    f.field("angle",              params.angle);
+    f.field("transmit_duration",  params.transmit_duration);
+    f.field("sample_period",      params.sample_period);
+    f.field("transmit_frequency", params.transmit_frequency);
+    f.field("number_of_samples",  params.number_of_samples);
+}
+
+// Fields of the payloads, which may be truncated (available bytes).
+
+template <class Fields>
+inline void format_payload(Fields& f, MessageType<Acknowledged>,
+                           const uint8_t* payload, std::size_t available)
+{
+    f.begin("ping_protocol::Acknowledged");
+    if(available >= sizeof(uint16_t))
+        f.field("acked_id", *reinterpret_cast<const uint16_t*>(payload));
+}
+
+template <class Fields>
+inline void format_payload(Fields& f, MessageType<NotAcknowledged>,
+                           const uint8_t* payload, std::size_t available)
+{
+    f.begin("ping_protocol::NotAcknowledged");
+    if(available >= sizeof(uint16_t)) {
+        f.field("nacked_id", *reinterpret_cast<const uint16_t*>(payload));
+        f.string_field("message", (const char*)payload + 2, available - 2);
+    }
+}
+
+template <class Fields>
+inline void format_payload(Fields& f, MessageType<AsciiMessage>,
+                           const uint8_t* payload, std::size_t available)
+{
+    f.begin("ping_protocol::AsciiMessage");
+    f.string_field("message", (const char*)payload, available);
+}
+
+template <class Fields>
+inline void format_payload(Fields& f, MessageType<GeneralRequest>,
+                           const uint8_t* payload, std::size_t available)
+{
+    f.begin("ping_protocol::GeneralRequest");
+    if(available >= sizeof(uint16_t))
+        f.field("requested_id", *reinterpret_cast<const uint16_t*>(payload));
+}
+
+template <class Fields>
+inline void format_payload(Fields& f, MessageType<DeviceInformation>,
+                           const uint8_t* payload, std::size_t available)
+{
+    f.begin("ping_protocol::DeviceInformation");
+    if(available >= sizeof(DeviceInformation::Information)) {
+        const auto& info = *reinterpret_cast<const DeviceInformation::Information*>(payload);
+        f.field("device_type",     (uint8_t)info.device_type);
+        f.field("device_revision", info.device_revision);
+        f.field("firmware_major",  info.firmware_version.major);
+        f.field("firmware_minor",  info.firmware_version.minor);
+        f.field("firmware_patch",  info.firmware_version.patch);
+    }
+}
+
+template <class Fields>
+inline void format_payload(Fields& f, MessageType<ProtocolVersion>,
+                           const uint8_t* payload, std::size_t available)
+{
+    f.begin("ping_protocol::ProtocolVersion");
+    if(available >= sizeof(Version)) {
+        const auto& version = *reinterpret_cast<const Version*>(payload);
+        f.field("version_major", version.major);
+        f.field("version_minor", version.minor);
+        f.field("version_patch", version.patch);
+    }
+}
+
+template <class Fields>
+inline void format_payload(Fields& f, MessageType<SetDeviceId>,
+                           const uint8_t* payload, std::size_t available)
+{
+    f.begin("ping_protocol::SetDeviceId");
+    if(available >= sizeof(uint8_t))
+        f.field("device_id", payload[0]);
+}
+
+template <class Fields>
+inline void format_payload(Fields& f, MessageType<ping360::SetPing360Id>,
+                           const uint8_t* payload, std::size_t available)
+{
+    f.begin("ping360::SetPing360Id");
+    if(available >= sizeof(uint8_t))
+        f.field("device_id", payload[0]);
+}
+
+template <class Fields>
+inline void format_payload(Fields& f, MessageType<ping360::DeviceData>,
+                           const uint8_t* payload, std::size_t available)
+{
+    f.begin("ping360::DeviceData");
+    if(available >= sizeof(ping360::DeviceData::Metadata)) {
+        const auto& meta = *reinterpret_cast<const ping360::DeviceData::Metadata*>(payload);
+        format_ping_parameters(f, meta);
+        f.field("data_length", meta.data_length);
+    }
+}
+
+template <class Fields>
+inline void format_payload(Fields& f, MessageType<ping360::Transducer>,
+                           const uint8_t* payload, std::size_t available)
+{
+    f.begin("ping360::Transducer");
+    if(available >= sizeof(ping360::Transducer::Config)) {
+        const auto& config = *reinterpret_cast<const ping360::Transducer::Config*>(payload);
+        format_ping_parameters(f, config);
+        f.field("transmit", config.transmit);
+    }
+}
+
+template <class Fields>
+inline void format_payload(Fields& f, MessageType<ping360::Reset>,
+                           const uint8_t* payload, std::size_t available)
+{
+    f.begin("ping360::Reset");
+    if(available >= sizeof(uint8_t))
+        f.field("run_bootloader", payload[0]);
+}
+
+template <class Fields>
+inline void format_payload(Fields& f, MessageType<ping360::MotorOff>,
+                           const uint8_t*, std::size_t)
+{
+    f.begin("ping360::MotorOff");
+}
+
+template <class Fields>
+struct PayloadFormatter
+{
+    Fields&              f;
+    const MessageHeader& header;
+    const uint8_t*       payload;
+    std::size_t          available;
+
+    void operator()(MessageType<Message>) const {
+        f.begin("ping_protocol::Message");
+        f.field("message_id",     header.message_id);
+        f.field("payload_length", header.payload_length);
+    }
+    template <class T>
+    void operator()(MessageType<T> type) const {
+        format_payload(f, type, payload, available);
+    }
+};
+
+/**
+ * Writes the fields of the frame [frame, frame + size) to f. The frame may be
+ * truncated (for example to skip sample data), in which case the fields which
+ * are not available are omitted.
+ */
+template <class Fields>
+inline void format_fields(Fields& f, const uint8_t* frame, std::size_t size)
+{
+    if(size < sizeof(MessageHeader)) {
+        f.begin("ping_protocol::InvalidMessage");
+        f.end();
+        return;
+    }
+    const auto& header = *reinterpret_cast<const MessageHeader*>(frame);
+    std::size_t available = std::min<std::size_t>(size - sizeof(MessageHeader),
+                                                  header.payload_length);
+    visit_message_type(header.message_id, PayloadFormatter<Fields>{
+        f, header, frame + sizeof(MessageHeader), available});
+    f.end();
+}
+
+/**
+ * Formats a frame on a single line terminated by '\n' into [buffer, buffer +
+ * bufferSize). Returns the number of characters written (no null character
+ * is appended). Output is truncated if the buffer is too small, the line
+ * still ends with '\n'. A truncated JSON line ends after its last complete
+ * field with "truncated":true, or is dropped (0 is returned) if not even the
+ * message type fits.
+ */
+inline std::size_t format_message(char* buffer, std::size_t bufferSize,
+                                  const uint8_t* frame, std::size_t frameSize,
+                                  LogFormat format = LogFormat::Text)
+{
+    if(bufferSize == 0) {
+        return 0;
+    }
+    if(format == LogFormat::Json) {
+        static const char suffix[] = ",\"truncated\":true}\n";
+        FormatBuffer out(buffer, bufferSize);
+        JsonFields f({out, sizeof(suffix) - 1});
+        format_fields(f, frame, frameSize);
+        if(!out.truncated()) {
+            return out.size();
+        }
+        // Closed after the last field leaving room for the suffix.
+        if(f.complete == 0) {
+            return 0;
+        }
+        std::memcpy(buffer + f.complete, suffix, sizeof(suffix) - 1);
+        return f.complete + sizeof(suffix) - 1;
+    }
+
+    // Last character kept for the '\n' of a truncated line.
+    FormatBuffer out(buffer, bufferSize - 1);
+    TextFields f({out});
+    format_fields(f, frame, frameSize);
+    if(out.truncated()) {
+        buffer[out.size()] = '\n';
+        return out.size() + 1;
+    }
+    return out.size();
+}
+
+inline std::size_t format_message(char* buffer, std::size_t bufferSize,
+                                  const Message& msg,
+                                  LogFormat format = LogFormat::Text)
+{
+    return format_message(buffer, bufferSize, msg.data(), msg.size(), format);
+}
+
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_MESSAGES_FORMAT_UTILS_H_
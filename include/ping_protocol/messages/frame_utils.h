@@ -0,0 +1,59 @@
+#ifndef _DEF_PING_PROTOCOL_MESSAGES_FRAME_UTILS_H_
+#define _DEF_PING_PROTOCOL_MESSAGES_FRAME_UTILS_H_
+
+#include <cstring>
+
+#include <ping_protocol/messages/MessageBase.h>
+
+namespace ping_protocol {
+
+/**
+ * Returns the size of the frame starting at data, or 0 if data does not start
+ * with a complete frame with a valid checksum. Nothing is copied.
+ */
+inline std::size_t frame_size(const uint8_t* data, std::size_t size)
+{
+    if(size < sizeof(MessageHeader) + 2 || data[0] != 'B' || data[1] != 'R') {
+        return 0;
+    }
+    uint16_t payloadLength;
+    std::memcpy(&payloadLength, data + 2, sizeof(payloadLength));
+
+    std::size_t frameSize = sizeof(MessageHeader) + payloadLength + 2;
+    if(size < frameSize) {
+        return 0;
+    }
+    uint16_t checksum;
+    std::memcpy(&checksum, data + frameSize - 2, sizeof(checksum));
+    if(checksum != compute_checksum(data)) {
+        return 0;
+    }
+    return frameSize;
+}
+
+/**
+ * Calls f(const uint8_t* frame, std::size_t frameSize) for each valid frame
+ * found in [data, data + size). Frames are handed out in place. Invalid bytes
+ * are skipped one at a time until a valid frame is found. Returns the number
+ * of skipped bytes.
+ */
+template <class F>
+std::size_t for_each_frame(const uint8_t* data, std::size_t size, F&& f)
+{
+    std::size_t skipped = 0;
+    for(std::size_t offset = 0; offset < size; ) {
+        std::size_t frameSize = frame_size(data + offset, size - offset);
+        if(frameSize == 0) {
+            offset++;
+            skipped++;
+            continue;
+        }
+        f(data + offset, frameSize);
+        offset += frameSize;
+    }
+    return skipped;
+}
+
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_MESSAGES_FRAME_UTILS_H_
@@ -0,0 +1,85 @@
+#ifndef _DEF_PING_PROTOCOL_MESSAGES_GENERATED_LAYOUTS_H_
+#define _DEF_PING_PROTOCOL_MESSAGES_GENERATED_LAYOUTS_H_
+
+#include <cstddef>
+
+#include <ping_protocol/messages/common.h>
+#include <ping_protocol/messages/Ping360Messages.h>
+#include <ping_protocol/generated/common.h>
+#include <ping_protocol/generated/ping360.h>
+
+// Checks the views generated from the definition files against the
+// hand-written messages. Include it where generated views are read in place
+// of the hand-written ones.
+
+#define PING_PROTOCOL_CHECK_MESSAGE(View, Handwritten)                        \
+    static_assert(generated::View::MessageId == Handwritten::MessageId        \
+                  && generated::View::FixedSize == Handwritten::FixedSize,    \
+                  #View " id or size differs from the hand-written message")
+
+#define PING_PROTOCOL_CHECK_FIELD(View, field, offset, size)                  \
+    static_assert(offsetof(generated::View::Layout, field) == (offset)        \
+                  && sizeof(generated::View::Layout::field) == (size),        \
+                  #View "::" #field " differs from the hand-written message")
+
+// PingParameters fields, shared by DeviceData and Transducer.
+#define PING_PROTOCOL_CHECK_PING_PARAMETERS(View)                             \
+    PING_PROTOCOL_CHECK_FIELD(View, mode,                                     \
+        offsetof(ping360::PingParameters, mode), 1);                          \
+    PING_PROTOCOL_CHECK_FIELD(View, gain_setting,                             \
+        offsetof(ping360::PingParameters, gain_setting), 1);                  \
+    PING_PROTOCOL_CHECK_FIELD(View, angle,                                    \
+        offsetof(ping360::PingParameters, angle), 2);                         \
+    PING_PROTOCOL_CHECK_FIELD(View, transmit_duration,                        \
+        offsetof(ping360::PingParameters, transmit_duration), 2);             \
+    PING_PROTOCOL_CHECK_FIELD(View, sample_period,                            \
+        offsetof(ping360::PingParameters, sample_period), 2);                 \
+    PING_PROTOCOL_CHECK_FIELD(View, transmit_frequency,                       \
+        offsetof(ping360::PingParameters, transmit_frequency), 2);            \
+    PING_PROTOCOL_CHECK_FIELD(View, number_of_samples,                        \
+        offsetof(ping360::PingParameters, number_of_samples), 2)
+
+namespace ping_protocol {
+
+PING_PROTOCOL_CHECK_MESSAGE(common::Ack,               Acknowledged);
+PING_PROTOCOL_CHECK_MESSAGE(common::GeneralRequest,    GeneralRequest);
+PING_PROTOCOL_CHECK_MESSAGE(common::ProtocolVersion,   ProtocolVersion);
+PING_PROTOCOL_CHECK_MESSAGE(common::DeviceInformation, DeviceInformation);
+PING_PROTOCOL_CHECK_MESSAGE(ping360::DeviceId,         ping360::SetPing360Id);
+PING_PROTOCOL_CHECK_MESSAGE(ping360::DeviceData,       ping360::DeviceData);
+PING_PROTOCOL_CHECK_MESSAGE(ping360::Transducer,       ping360::Transducer);
+PING_PROTOCOL_CHECK_MESSAGE(ping360::Reset,            ping360::Reset);
+PING_PROTOCOL_CHECK_MESSAGE(ping360::MotorOff,         ping360::MotorOff);
+
+PING_PROTOCOL_CHECK_FIELD(common::GeneralRequest, requested_id, 0, sizeof(uint16_t));
+PING_PROTOCOL_CHECK_FIELD(common::ProtocolVersion, version_major, offsetof(Version, major), 1);
+PING_PROTOCOL_CHECK_FIELD(common::ProtocolVersion, version_minor, offsetof(Version, minor), 1);
+PING_PROTOCOL_CHECK_FIELD(common::ProtocolVersion, version_patch, offsetof(Version, patch), 1);
+PING_PROTOCOL_CHECK_FIELD(common::DeviceInformation, device_type,
+    offsetof(DeviceInformation::Information, device_type), sizeof(PingDeviceType));
+PING_PROTOCOL_CHECK_FIELD(common::DeviceInformation, device_revision,
+    offsetof(DeviceInformation::Information, device_revision), 1);
+PING_PROTOCOL_CHECK_FIELD(common::DeviceInformation, firmware_version_major,
+    offsetof(DeviceInformation::Information, firmware_version) + offsetof(Version, major), 1);
+
+PING_PROTOCOL_CHECK_PING_PARAMETERS(ping360::DeviceData);
+PING_PROTOCOL_CHECK_PING_PARAMETERS(ping360::Transducer);
+
+// The derived hand-written structs are not standard layout (no offsetof),
+// their own fields follow PingParameters.
+PING_PROTOCOL_CHECK_FIELD(ping360::DeviceData, data_length, sizeof(ping360::PingParameters),
+    sizeof(ping360::DeviceData::Metadata::data_length));
+PING_PROTOCOL_CHECK_FIELD(ping360::Transducer, transmit, sizeof(ping360::PingParameters),
+    sizeof(ping360::Transducer::Config::transmit));
+static_assert(sizeof(generated::ping360::DeviceData::Layout) == sizeof(ping360::DeviceData::Metadata),
+              "ping360::DeviceData layout differs from the hand-written message");
+static_assert(sizeof(generated::ping360::Transducer::Layout) == sizeof(ping360::Transducer::Config),
+              "ping360::Transducer layout differs from the hand-written message");
+
+} //namespace ping_protocol
+
+#undef PING_PROTOCOL_CHECK_PING_PARAMETERS
+#undef PING_PROTOCOL_CHECK_FIELD
+#undef PING_PROTOCOL_CHECK_MESSAGE
+
+#endif //_DEF_PING_PROTOCOL_MESSAGES_GENERATED_LAYOUTS_H_
@@ -0,0 +1,43 @@
+#ifndef _DEF_PING_PROTOCOL_MESSAGES_MESSAGE_TYPES_H_
+#define _DEF_PING_PROTOCOL_MESSAGES_MESSAGE_TYPES_H_
+
+#include <cstdint>
+
+#include <ping_protocol/messages/MessageBase.h>
+#include <ping_protocol/messages/common.h>
+#include <ping_protocol/messages/Ping360Messages.h>
+
+namespace ping_protocol {
+
+template <class T>
+struct MessageType { using type = T; };
+
+/**
+ * Calls visitor with MessageType<T>, T being the hand-written message with
+ * this id, or Message if the id is unknown. This is the list of messages
+ * known to print() and format_message().
+ */
+template <class Visitor>
+inline void visit_message_type(uint16_t messageId, Visitor&& visitor)
+{
+    switch(messageId) {
+        default: visitor(MessageType<Message>()); break;
+
+        case Acknowledged::MessageId:          visitor(MessageType<Acknowledged>());          break;
+        case NotAcknowledged::MessageId:       visitor(MessageType<NotAcknowledged>());       break;
+        case AsciiMessage::MessageId:          visitor(MessageType<AsciiMessage>());          break;
+        case GeneralRequest::MessageId:        visitor(MessageType<GeneralRequest>());        break;
+        case DeviceInformation::MessageId:     visitor(MessageType<DeviceInformation>());     break;
+        case ProtocolVersion::MessageId:       visitor(MessageType<ProtocolVersion>());       break;
+        case SetDeviceId::MessageId:           visitor(MessageType<SetDeviceId>());           break;
+        case ping360::SetPing360Id::MessageId: visitor(MessageType<ping360::SetPing360Id>()); break;
+        case ping360::DeviceData::MessageId:   visitor(MessageType<ping360::DeviceData>());   break;
+        case ping360::Transducer::MessageId:   visitor(MessageType<ping360::Transducer>());   break;
+        case ping360::Reset::MessageId:        visitor(MessageType<ping360::Reset>());        break;
+        case ping360::MotorOff::MessageId:     visitor(MessageType<ping360::MotorOff>());     break;
+    }
+}
+
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_MESSAGES_MESSAGE_TYPES_H_
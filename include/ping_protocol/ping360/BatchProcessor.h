@@ -0,0 +1,133 @@
+#ifndef _DEF_PING_PROTOCOL_PING360_BATCH_PROCESSOR_H_
+#define _DEF_PING_PROTOCOL_PING360_BATCH_PROCESSOR_H_
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <functional>
+
+#include <ping_protocol/messages/Ping360Messages.h>
+#include <ping_protocol/ping360/Sweep.h>
+
+namespace ping_protocol { namespace ping360 {
+
+/**
+ * Offline processing of a raw recording (ping-protocol frames as received
+ * from the device, possibly with invalid bytes between frames) on all cores.
+ *
+ * The recording is processed in three passes :
+ * - frames are located and their checksums validated in parallel on equal
+ *   byte ranges. The range boundaries are resynchronized so the frame list
+ *   is exactly the one given by a serial for_each_frame.
+ * - DeviceData rows are split into sweeps with the SweepAssembler rule
+ *   (repeated angle or geometry change). This only reads the frame index.
+ * - consecutive sweeps are grouped in chunks and processed by a work
+ *   stealing thread pool (sweep assembly, filter, scan conversion).
+ *
+ * Results are handed to the output in sweep order, so the output does not
+ * depend on the thread count or on the scheduling.
+ */
+class BatchProcessor
+{
+    public:
+
+    using Ptr      = std::shared_ptr<BatchProcessor>;
+    using ConstPtr = std::shared_ptr<const BatchProcessor>;
+
+    struct Row {
+        uint64_t       offset;      // of the frame in the recording
+        PingParameters parameters;
+        uint16_t       sampleCount; // data_length clamped to the received payload
+    };
+
+    struct Result {
+        unsigned int   index;       // sweep index in the recording
+        uint64_t       offset;      // of the first row of the sweep
+        const Sweep*   sweep;
+        const uint8_t* image;       // scan converted sweep, nullptr if disabled
+        unsigned int   imageWidth;
+    };
+
+    // Called concurrently from the worker threads on each assembled sweep.
+    using Filter = std::function<void(Sweep&)>;
+    // Called in sweep order, one call at a time.
+    using Output = std::function<void(const Result&)>;
+
+    struct Config {
+        unsigned int threadCount;      // 0 : one thread per core
+        unsigned int sweepsPerChunk;
+        unsigned int maxPendingChunks; // per thread, results waiting for a previous chunk
+        unsigned int imageWidth;       // 0 disables scan conversion
+        unsigned int angleStep;
+        float        soundSpeed;
+    };
+
+    static Config default_config() {
+        Config res;
+        res.threadCount      = 0;
+        res.sweepsPerChunk   = 4;
+        res.maxPendingChunks = 4;
+        res.imageWidth       = 512;
+        res.angleStep        = 1;
+        res.soundSpeed       = 1500.0f;
+        return res;
+    }
+
+    struct Statistics {
+        uint64_t     bytes;
+        uint64_t     skippedBytes;
+        uint64_t     frameCount;
+        uint64_t     rowCount;
+        unsigned int sweepCount;
+        unsigned int chunkCount;
+        unsigned int threadCount;
+        uint64_t     stealCount;
+        double       indexTime;    // seconds, frame validation and sweep split
+        double       processTime;  // seconds
+        double       totalTime;
+
+        double sweeps_per_second() const {
+            return totalTime > 0.0 ? sweepCount / totalTime : 0.0;
+        }
+        double sweeps_per_second_per_core() const {
+            return threadCount > 0 ? this->sweeps_per_second() / threadCount : 0.0;
+        }
+    };
+
+    protected:
+
+    Config                config_;
+    Filter                filter_;
+    Output                output_;
+    Statistics            stats_;
+    std::vector<Row>      rows_;
+    std::vector<uint32_t> sweepStarts_; // first row of each sweep, then rows_.size()
+
+    void index_frames(const uint8_t* data, std::size_t size);
+    void split_sweeps();
+    void process_sweeps(const uint8_t* data);
+
+    public:
+
+    BatchProcessor(const Config& config = default_config());
+
+    static Ptr Create(const Config& config = default_config());
+
+    const Config& config() const { return config_; }
+    void set_filter(const Filter& filter) { filter_ = filter; }
+    void set_output(const Output& output) { output_ = output; }
+
+    const Statistics&       statistics() const { return stats_; }
+    const std::vector<Row>& rows()       const { return rows_; }
+    unsigned int sweep_count() const {
+        return sweepStarts_.empty() ? 0 : sweepStarts_.size() - 1;
+    }
+
+    const Statistics& process(const uint8_t* data, std::size_t size);
+    const Statistics& process_file(const std::string& path);
+};
+
+} //namespace ping360
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_PING360_BATCH_PROCESSOR_H_
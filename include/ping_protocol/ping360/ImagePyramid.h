@@ -0,0 +1,144 @@
+#ifndef _DEF_PING_PROTOCOL_PING360_IMAGE_PYRAMID_H_
+#define _DEF_PING_PROTOCOL_PING360_IMAGE_PYRAMID_H_
+
+#include <memory>
+#include <vector>
+
+#include <ping_protocol/messages/Ping360Messages.h>
+#include <ping_protocol/ping360/WedgeRenderer.h>
+
+namespace ping_protocol { namespace ping360 {
+
+/**
+ * Pyramid of 8 bit images, each level being the previous one decimated by 2
+ * in both dimensions (max or mean of 2x2 blocks, edge pixels are repeated for
+ * odd sizes).
+ *
+ * Level 0 is written in place (level_data(0)) and the modified rectangle is
+ * propagated to the other levels with update(), so only the blocks covering
+ * the modified pixels are reduced. Levels are split in square tiles of
+ * tileSize pixels. Each tile has a version number incremented when one of its
+ * pixels is updated, so a display only fetches visible tiles which changed.
+ */
+class ImagePyramid
+{
+    public:
+
+    using Ptr      = std::shared_ptr<ImagePyramid>;
+    using ConstPtr = std::shared_ptr<const ImagePyramid>;
+
+    enum Reduction {
+        Max,  // keeps small strong echoes visible when zoomed out
+        Mean
+    };
+
+    struct Tile {
+        unsigned int   level;
+        unsigned int   column;
+        unsigned int   row;
+        const uint8_t* data;    // first pixel of the tile
+        unsigned int   stride;  // row stride in bytes (width of the level)
+        unsigned int   width;   // smaller than tileSize on the level borders
+        unsigned int   height;
+        uint64_t       version;
+    };
+
+    protected:
+
+    struct Level {
+        unsigned int          width;
+        unsigned int          height;
+        unsigned int          columns; // tile count
+        unsigned int          rows;
+        std::vector<uint8_t>  data;
+        std::vector<uint64_t> versions;
+    };
+
+    Reduction          reduction_;
+    unsigned int       tileSize_;
+    unsigned int       maxLevelCount_;
+    std::vector<Level> levels_;
+
+    Rectangle reduce(unsigned int level, const Rectangle& dirty);
+    void touch(Level& level, const Rectangle& dirty);
+
+    public:
+
+    // levelCount = 0 adds levels until the last one fits in a single tile.
+    ImagePyramid(unsigned int width, unsigned int height,
+                 Reduction reduction = Max, unsigned int tileSize = 256,
+                 unsigned int levelCount = 0);
+
+    static Ptr Create(unsigned int width, unsigned int height,
+                      Reduction reduction = Max, unsigned int tileSize = 256,
+                      unsigned int levelCount = 0);
+
+    void resize(unsigned int width, unsigned int height);
+    void clear();
+
+    Reduction    reduction()   const { return reduction_; }
+    unsigned int tile_size()   const { return tileSize_; }
+    unsigned int level_count() const { return levels_.size(); }
+    unsigned int width(unsigned int level = 0)  const { return levels_[level].width; }
+    unsigned int height(unsigned int level = 0) const { return levels_[level].height; }
+    const uint8_t* level_data(unsigned int level) const { return levels_[level].data.data(); }
+    uint8_t*       level_data(unsigned int level)       { return levels_[level].data.data(); }
+
+    unsigned int tile_columns(unsigned int level) const { return levels_[level].columns; }
+    unsigned int tile_rows(unsigned int level)    const { return levels_[level].rows; }
+    Tile tile(unsigned int level, unsigned int column, unsigned int row) const;
+
+    // Propagates a rectangle modified in level 0.
+    void update(const Rectangle& dirty);
+    // Copies a rectangle of a width x height source image into level 0 and
+    // propagates it.
+    void update(const uint8_t* source, unsigned int sourceStride, const Rectangle& dirty);
+};
+
+/**
+ * Polar and Cartesian pyramids of the sonar image, updated for each received
+ * row.
+ *
+ * The polar level 0 has one row per angle (AngleCount rows) of
+ * number_of_samples pixels. The Cartesian level 0 is the WedgeRenderer
+ * image.
+ */
+class SweepPyramid
+{
+    public:
+
+    using Ptr      = std::shared_ptr<SweepPyramid>;
+    using ConstPtr = std::shared_ptr<const SweepPyramid>;
+
+    static constexpr unsigned int AngleCount = Sweep::AngleCount;
+
+    protected:
+
+    WedgeRenderer renderer_;
+    ImagePyramid  polar_;
+    ImagePyramid  cartesian_;
+    uint16_t      samplePeriod_;
+
+    public:
+
+    SweepPyramid(unsigned int cartesianWidth,
+                 ImagePyramid::Reduction reduction = ImagePyramid::Max,
+                 unsigned int tileSize = 256, float soundSpeed = 1500.0f);
+
+    static Ptr Create(unsigned int cartesianWidth,
+                      ImagePyramid::Reduction reduction = ImagePyramid::Max,
+                      unsigned int tileSize = 256, float soundSpeed = 1500.0f);
+
+    const WedgeRenderer& renderer()  const { return renderer_; }
+    WedgeRenderer&       renderer()        { return renderer_; }
+    const ImagePyramid&  polar()     const { return polar_; }
+    const ImagePyramid&  cartesian() const { return cartesian_; }
+
+    void clear();
+    void add_row(const DeviceData& row);
+};
+
+} //namespace ping360
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_PING360_IMAGE_PYRAMID_H_
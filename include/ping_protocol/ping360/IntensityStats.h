@@ -0,0 +1,162 @@
+#ifndef _DEF_PING_PROTOCOL_PING360_INTENSITY_STATS_H_
+#define _DEF_PING_PROTOCOL_PING360_INTENSITY_STATS_H_
+
+#include <memory>
+#include <vector>
+
+#include <ping_protocol/messages/Ping360Messages.h>
+#include <ping_protocol/ping360/Sweep.h>
+
+namespace ping_protocol { namespace ping360 {
+
+/**
+ * Exact 256 bins histogram of 8 bit intensities. Every statistic (mean,
+ * percentiles, saturation) is derived from the bins, so histograms can be
+ * added and subtracted.
+ */
+class IntensityHistogram
+{
+    public:
+
+    static constexpr unsigned int BinCount = 256;
+
+    protected:
+
+    uint32_t bins_[BinCount];
+    uint32_t count_;
+
+    public:
+
+    IntensityHistogram() { this->clear(); }
+
+    void clear();
+    void add(const uint8_t* data, std::size_t size);
+
+    const uint32_t* bins() const { return bins_; }
+    uint32_t*       bins()       { return bins_; }
+    uint32_t count() const { return count_; }
+    void set_count(uint32_t count) { count_ = count; }
+
+    float   mean() const;
+    uint8_t max() const;
+    // Smallest value v such that at least p*count() samples are <= v.
+    uint8_t percentile(float p) const;
+    // Fraction of samples >= level.
+    float fraction_above(uint8_t level) const;
+};
+
+/**
+ * Histograms of the last received row and of the last row of every angle
+ * (sliding window of one full turn), updated in O(BinCount) per row.
+ */
+class SweepStatistics
+{
+    public:
+
+    using Ptr      = std::shared_ptr<SweepStatistics>;
+    using ConstPtr = std::shared_ptr<const SweepStatistics>;
+
+    static constexpr unsigned int AngleCount = Sweep::AngleCount;
+    static constexpr unsigned int BinCount   = IntensityHistogram::BinCount;
+
+    protected:
+
+    IntensityHistogram    row_;
+    IntensityHistogram    sweep_;
+    std::vector<uint16_t> rowBins_;   // AngleCount histograms
+    std::vector<uint16_t> rowCounts_;
+
+    public:
+
+    SweepStatistics();
+
+    static Ptr Create() { return Ptr(new SweepStatistics()); }
+
+    void reset();
+    const IntensityHistogram& add_row(const DeviceData& row);
+
+    const IntensityHistogram& row()   const { return row_; }
+    const IntensityHistogram& sweep() const { return sweep_; }
+};
+
+/**
+ * Adjusts gain_setting and transmit_duration between pings to keep an
+ * intensity percentile within a target band.
+ *
+ * Exposure is changed along a single ladder : transmit_duration is scaled by
+ * transmitStep between its bounds, and gain_setting is changed by one step
+ * when transmit_duration reaches a bound. Nothing changes while the
+ * percentile stays in [targetLow, targetHigh] (hysteresis), and only rows
+ * acquired with the current settings are taken into account, so the
+ * controller reacts on the first ping showing the effect of a change.
+ */
+class AutoGainController
+{
+    public:
+
+    using Ptr      = std::shared_ptr<AutoGainController>;
+    using ConstPtr = std::shared_ptr<const AutoGainController>;
+
+    static constexpr uint8_t      MaxGainSetting  = 2; // low, normal, high
+    static constexpr unsigned int MaxPendingPings = 4;
+
+    struct Config {
+        float    percentile;
+        uint8_t  targetLow;
+        uint8_t  targetHigh;
+        uint8_t  saturationLevel;
+        float    maxSaturation;       // fraction of samples >= saturationLevel
+        uint16_t minTransmitDuration; // micro-seconds
+        uint16_t maxTransmitDuration;
+        float    transmitStep;        // > 1
+    };
+
+    static Config default_config() {
+        Config res;
+        res.percentile          = 0.99f;
+        res.targetLow           = 100;
+        res.targetHigh          = 220;
+        res.saturationLevel     = 250;
+        res.maxSaturation       = 0.005f;
+        res.minTransmitDuration = 5;
+        res.maxTransmitDuration = 500;
+        res.transmitStep        = 1.25f;
+        return res;
+    }
+
+    protected:
+
+    Config       config_;
+    uint8_t      gainSetting_;
+    uint16_t     transmitDuration_;
+    unsigned int adjustmentCount_;
+    unsigned int pendingPings_;
+
+    bool decrease();
+    bool increase();
+
+    public:
+
+    AutoGainController(const Config& config = default_config(),
+                       uint8_t gainSetting = 0, uint16_t transmitDuration = 100);
+
+    static Ptr Create(const Config& config = default_config(),
+                      uint8_t gainSetting = 0, uint16_t transmitDuration = 100);
+
+    const Config& config() const { return config_; }
+    uint8_t  gain_setting()      const { return gainSetting_; }
+    uint16_t transmit_duration() const { return transmitDuration_; }
+    unsigned int adjustment_count() const { return adjustmentCount_; }
+
+    // Returns true if the settings changed.
+    bool update(const IntensityHistogram& stats, const PingParameters& rowParameters);
+    bool update(const DeviceData& row);
+
+    // Base configuration with the current settings.
+    Transducer::Config apply(const Transducer::Config& base) const;
+};
+
+} //namespace ping360
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_PING360_INTENSITY_STATS_H_
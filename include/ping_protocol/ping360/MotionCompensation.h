@@ -0,0 +1,215 @@
+#ifndef _DEF_PING_PROTOCOL_PING360_MOTION_COMPENSATION_H_
+#define _DEF_PING_PROTOCOL_PING360_MOTION_COMPENSATION_H_
+
+#include <memory>
+#include <vector>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <functional>
+
+#include <ping_protocol/messages/Ping360Messages.h>
+#include <ping_protocol/ping360/Sweep.h>
+
+namespace ping_protocol { namespace ping360 {
+
+/**
+ * Horizontal pose of the vehicle in a world-fixed frame : x points north, y
+ * east (meters), heading is clockwise from north (radians). time is in
+ * seconds, in the time base of the ping timestamps.
+ */
+struct Pose
+{
+    double time;
+    double x;
+    double y;
+    double heading;
+};
+
+/**
+ * Time-ordered pose buffer with linear interpolation (shortest way for the
+ * heading).
+ */
+class PoseInterpolator
+{
+    public:
+
+    using Ptr      = std::shared_ptr<PoseInterpolator>;
+    using ConstPtr = std::shared_ptr<const PoseInterpolator>;
+
+    protected:
+
+    std::deque<Pose> poses_;
+    double           maxGap_;
+
+    public:
+
+    // Poses further than maxGap seconds apart are not interpolated.
+    PoseInterpolator(double maxGap = 1.0);
+
+    static Ptr Create(double maxGap = 1.0);
+
+    bool        empty()      const { return poses_.empty(); }
+    std::size_t size()       const { return poses_.size(); }
+    double      first_time() const { return poses_.front().time; }
+    double      last_time()  const { return poses_.back().time; }
+
+    // Poses are expected in time order, older ones are ignored (returns false).
+    bool add(const Pose& pose);
+    // Keeps the last pose at or before time and the ones after it.
+    void discard_before(double time);
+    bool interpolate(double time, Pose& out) const;
+
+    /**
+     * Reads poses from a text file, one "time,x,y,heading" line per pose
+     * (heading in degrees, as usually logged by navigation systems). Lines
+     * which do not start with a number (headers, comments) are skipped.
+     */
+    static std::vector<Pose> load_csv(const std::string& path);
+};
+
+/**
+ * Accumulates ping360 rows in a world-fixed Cartesian grid, each row being
+ * placed with the pose of the vehicle interpolated at the time of the ping.
+ *
+ * The grid is north-up, width x height cells of cellSize meters, centered on
+ * (originX, originY). Each cell holds the mean of the samples which fell in
+ * it since the last clear().
+ *
+ * The footprint of a beam (points covering the angleStep wide wedge of a
+ * ping, at most half a cell apart) is precomputed once per geometry, in the
+ * sonar frame. Placing a row is a rigid transform of these points, done in
+ * batches with SSE2, followed by the accumulation.
+ *
+ * Rows received before the poses covering their timestamp are kept pending
+ * until these poses arrive. Poses and rows may be added from different
+ * threads.
+ */
+class MotionCompensatedAssembler
+{
+    public:
+
+    using Ptr      = std::shared_ptr<MotionCompensatedAssembler>;
+    using ConstPtr = std::shared_ptr<const MotionCompensatedAssembler>;
+
+    // Called when a sweep is complete (SweepAssembler rule), before the
+    // first row of the next sweep is accumulated. The assembler is locked :
+    // only the grid accessors (sums(), counts(), image()) may be used.
+    using SweepCallback = std::function<void(const MotionCompensatedAssembler&)>;
+
+    static constexpr unsigned int AngleCount = Sweep::AngleCount;
+
+    struct Config {
+        float        cellSize;        // meters
+        unsigned int width;           // cells
+        unsigned int height;
+        double       originX;         // world position of the grid center
+        double       originY;
+        unsigned int angleStep;       // gradians covered by a ping
+        float        soundSpeed;
+        float        forwardOffset;   // sonar position on the vehicle (meters)
+        float        starboardOffset;
+        float        headingOffset;   // sonar angle 0 relative to the vehicle heading (radians)
+        double       timeOffset;      // added to the ping timestamps (seconds)
+        double       maxPoseGap;      // seconds
+        double       poseHistory;     // poses kept before the last placed row (seconds)
+        unsigned int maxPendingRows;  // rows waiting for a pose
+        bool         clearOnSweep;    // one image per sweep instead of a mosaic
+    };
+
+    static Config default_config() {
+        Config res;
+        res.cellSize        = 0.1f;
+        res.width           = 1024;
+        res.height          = 1024;
+        res.originX         = 0.0;
+        res.originY         = 0.0;
+        res.angleStep       = 1;
+        res.soundSpeed      = 1500.0f;
+        res.forwardOffset   = 0.0f;
+        res.starboardOffset = 0.0f;
+        res.headingOffset   = 0.0f;
+        res.timeOffset      = 0.0;
+        res.maxPoseGap      = 1.0;
+        res.poseHistory     = 5.0;
+        res.maxPendingRows  = 256;
+        res.clearOnSweep    = false;
+        return res;
+    }
+
+    struct Statistics {
+        uint64_t rowCount;     // rows received
+        uint64_t placedCount;  // rows accumulated in the grid
+        uint64_t droppedCount; // rows without a pose (too old, gap, pending overflow)
+        uint64_t pointCount;   // footprint points transformed
+        uint64_t sweepCount;
+    };
+
+    protected:
+
+    struct PendingRow {
+        double     time;
+        DeviceData row;
+    };
+
+    Config                 config_;
+    Statistics             stats_;
+    mutable std::mutex     mutex_;
+    PoseInterpolator       poses_;
+    std::deque<PendingRow> pending_;
+    SweepCallback          sweepCallback_;
+
+    std::vector<uint32_t> sums_;
+    std::vector<uint32_t> counts_;
+
+    // Footprint of a beam in the sonar frame, in cells, with points sorted
+    // by sample : points of samples [0, s) are the first sampleEnds_[s] ones.
+    uint16_t              sampleCount_;
+    uint16_t              samplePeriod_;
+    std::vector<float>    footprintU_;  // along the beam
+    std::vector<float>    footprintV_;  // to starboard
+    std::vector<uint16_t> footprintSamples_;
+    std::vector<uint32_t> sampleEnds_;
+
+    // SweepAssembler rule
+    std::vector<uint8_t> filled_;
+    bool                 sweepStarted_;
+
+    void clear_grid();
+    void update_footprint(uint16_t sampleCount, uint16_t samplePeriod);
+    void check_sweep(const PingParameters& params);
+    void place(const DeviceData& row, const Pose& pose);
+    void process_pending();
+
+    public:
+
+    MotionCompensatedAssembler(const Config& config = default_config());
+
+    static Ptr Create(const Config& config = default_config());
+
+    const Config& config() const { return config_; }
+    Statistics statistics() const;
+    void set_sweep_callback(const SweepCallback& callback);
+
+    void add_pose(const Pose& pose);
+    void add_poses(const std::vector<Pose>& poses);
+    // timestamp : receive time of the row, in the time base of the poses.
+    void add_row(const DeviceData& row, double timestamp);
+
+    void clear();
+    void set_origin(double x, double y); // clears the grid
+
+    unsigned int width()  const { return config_.width; }
+    unsigned int height() const { return config_.height; }
+    // Grid accessors are not locked : use them from the sweep callback or
+    // when no row is being added.
+    const uint32_t* sums()   const { return sums_.data(); }
+    const uint32_t* counts() const { return counts_.data(); }
+    // Mean of each cell (0 where nothing was accumulated), width*height bytes.
+    void image(std::vector<uint8_t>& out) const;
+};
+
+} //namespace ping360
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_PING360_MOTION_COMPENSATION_H_
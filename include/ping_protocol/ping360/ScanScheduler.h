@@ -0,0 +1,130 @@
+#ifndef _DEF_PING_PROTOCOL_PING360_SCAN_SCHEDULER_H_
+#define _DEF_PING_PROTOCOL_PING360_SCAN_SCHEDULER_H_
+
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+#include <ping_protocol/messages/Ping360Messages.h>
+#include <ping_protocol/ping360/Sweep.h>
+
+namespace ping_protocol { namespace ping360 {
+
+/**
+ * Chooses the angle of the next Transducer request from a priority map.
+ *
+ * The circle is split in sectors of equal width, each with a priority in
+ * [0,1] (a base priority plus a boost raised by detections which decays over
+ * time). A sector is scanned in passes : a pass pings the whole sector with an
+ * angle step going from coarseStep (priority 0) to fineStep (priority 1),
+ * successive coarse passes being offset so that every angle is eventually
+ * visited. Passes are scheduled by stride scheduling so the share of pings
+ * a sector gets is proportional to its weight (minWeight + priority), except
+ * that a sector not refreshed for longer than 1/minRefreshRate is scanned
+ * first.
+ *
+ * next_angle() is meant to be called once per received ping, so the
+ * scheduler progresses at the rate of the device.
+ */
+class ScanScheduler
+{
+    public:
+
+    using Ptr      = std::shared_ptr<ScanScheduler>;
+    using ConstPtr = std::shared_ptr<const ScanScheduler>;
+
+    using Clock = std::chrono::steady_clock;
+
+    // Returns a priority increase for the sector containing the row.
+    using Detector = std::function<float(const DeviceData&)>;
+
+    static constexpr unsigned int AngleCount = Sweep::AngleCount;
+
+    struct Config {
+        unsigned int sectorCount;
+        unsigned int fineStep;       // angle step for priority 1
+        unsigned int coarseStep;     // angle step for priority 0
+        float        minWeight;      // weight of a priority 0 sector
+        float        minRefreshRate; // passes per second for every sector
+        float        boostHalfLife;  // seconds
+    };
+
+    static Config default_config() {
+        Config res;
+        res.sectorCount    = 16;
+        res.fineStep       = 1;
+        res.coarseStep     = 8;
+        res.minWeight      = 0.05f;
+        res.minRefreshRate = 0.05f;
+        res.boostHalfLife  = 10.0f;
+        return res;
+    }
+
+    struct SectorStats {
+        unsigned int startAngle;
+        unsigned int endAngle;    // excluded
+        float        priority;
+        unsigned int step;
+        unsigned int passCount;
+        float        refreshRate; // passes per second (smoothed)
+    };
+
+    protected:
+
+    struct Sector {
+        float             basePriority;
+        float             boost;
+        double            pass;     // stride scheduling virtual time
+        unsigned int      offset;   // first angle offset of the next pass
+        unsigned int      passCount;
+        float             refreshRate;
+        Clock::time_point lastComplete;
+    };
+
+    Config              config_;
+    std::vector<Sector> sectors_;
+    Detector            detector_;
+
+    int               current_;   // sector being scanned, -1 if none
+    unsigned int      cursor_;    // next angle of the current pass
+    unsigned int      step_;      // step of the current pass
+    Clock::time_point lastUpdate_;
+
+    unsigned int sector_start(unsigned int sector) const;
+    unsigned int sector_of(unsigned int angle) const;
+    float priority(const Sector& sector) const;
+    unsigned int step_for(float priority) const;
+    void decay_boosts(Clock::time_point now);
+    void start_pass(Clock::time_point now);
+    void complete_pass(Clock::time_point now);
+
+    public:
+
+    ScanScheduler(const Config& config = default_config());
+
+    static Ptr Create(const Config& config = default_config());
+
+    const Config& config() const { return config_; }
+    unsigned int sector_count() const { return sectors_.size(); }
+
+    void set_detector(const Detector& detector) { detector_ = detector; }
+    void set_priority(unsigned int sector, float priority);
+    void set_priority_map(const std::vector<float>& priorities);
+    void raise_priority(unsigned int angle, float amount);
+
+    unsigned int next_angle(Clock::time_point now = Clock::now());
+    Transducer::Config next_config(const Transducer::Config& base,
+                                   Clock::time_point now = Clock::now());
+
+    // Feedback from received data, runs the detector if any.
+    void report(const DeviceData& row);
+
+    SectorStats sector_stats(unsigned int sector) const;
+    std::vector<SectorStats> stats() const;
+};
+
+} //namespace ping360
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_PING360_SCAN_SCHEDULER_H_
@@ -0,0 +1,167 @@
+#ifndef _DEF_PING_PROTOCOL_PING360_SWEEP_H_
+#define _DEF_PING_PROTOCOL_PING360_SWEEP_H_
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+#include <ping_protocol/messages/Ping360Messages.h>
+
+namespace ping_protocol { namespace ping360 {
+
+/**
+ * Polar image assembled from ping360::DeviceData rows.
+ *
+ * Rows are indexed by their angle in gradians (the Ping360 native unit, 400
+ * per turn) and stored contiguously, row-major, with sample_count() samples
+ * per row.
+ */
+class Sweep
+{
+    public:
+
+    static constexpr unsigned int AngleCount = 400;
+
+    protected:
+
+    PingParameters       parameters_; // parameters of the last inserted row
+    uint16_t             sampleCount_;
+    std::vector<uint8_t> data_;
+    std::vector<uint8_t> filled_;
+    unsigned int         rowCount_;
+
+    public:
+
+    Sweep(uint16_t sampleCount = 0) :
+        sampleCount_(0),
+        rowCount_(0)
+    {
+        std::memset(&parameters_, 0, sizeof(parameters_));
+        this->reset(sampleCount);
+    }
+
+    void reset(uint16_t sampleCount) {
+        sampleCount_ = sampleCount;
+        data_.assign(AngleCount*sampleCount_, 0);
+        filled_.assign(AngleCount, 0);
+        rowCount_ = 0;
+    }
+    void clear() {
+        // keeps the geometry and the allocated memory
+        std::fill(data_.begin(),   data_.end(),   0);
+        std::fill(filled_.begin(), filled_.end(), 0);
+        rowCount_ = 0;
+    }
+
+    const PingParameters& parameters() const { return parameters_; }
+    uint16_t sample_count() const { return sampleCount_; }
+    uint16_t sample_period() const { return parameters_.sample_period; }
+    unsigned int row_count() const { return rowCount_; }
+    bool empty() const { return rowCount_ == 0; }
+
+    const uint8_t* data() const { return data_.data(); }
+    uint8_t*       data()       { return data_.data(); }
+    std::size_t    size() const { return data_.size(); }
+
+    const uint8_t* filled() const { return filled_.data(); }
+    bool has_row(unsigned int angle) const {
+        return filled_[angle % AngleCount] != 0;
+    }
+    const uint8_t* row(unsigned int angle) const {
+        return data_.data() + sampleCount_*(angle % AngleCount);
+    }
+    uint8_t* row(unsigned int angle) {
+        return data_.data() + sampleCount_*(angle % AngleCount);
+    }
+
+    bool same_geometry(const PingParameters& params) const {
+        return params.number_of_samples == sampleCount_
+            && params.sample_period     == parameters_.sample_period;
+    }
+
+    /**
+     * Copies a row in the sweep. The row is truncated or zero-padded to
+     * sample_count() samples. Returns the angle of the row.
+     */
+    unsigned int insert(const DeviceData& row) {
+        // data_length is read from the wire : do not trust it further than
+        // the payload actually received.
+        std::size_t available = row.payload_length() > sizeof(DeviceData::Metadata) ?
+            row.payload_length() - sizeof(DeviceData::Metadata) : 0;
+        std::size_t count = std::min<std::size_t>(row.metadata().data_length, available);
+        return this->set_row(row.ping_parameters(), row.data(), count);
+    }
+
+    /**
+     * Same as insert() from raw samples (count is the number of samples
+     * available in data).
+     */
+    unsigned int set_row(const PingParameters& params,
+                         const uint8_t* data, std::size_t count)
+    {
+        count = std::min<std::size_t>(count, sampleCount_);
+
+        unsigned int angle = params.angle % AngleCount;
+        uint8_t* dst = this->row(angle);
+        std::memcpy(dst, data, count);
+        std::memset(dst + count, 0, sampleCount_ - count);
+
+        if(!filled_[angle]) {
+            filled_[angle] = 1;
+            rowCount_++;
+        }
+        parameters_ = params;
+        return angle;
+    }
+};
+
+/**
+ * Builds sweeps from a stream of ping360::DeviceData rows.
+ *
+ * A sweep is considered finished when a row arrives for an angle which was
+ * already received (wrap around of a full scan, or direction change of a
+ * sector scan), or when the sampling geometry changes.
+ */
+class SweepAssembler
+{
+    public:
+
+    using Callback = std::function<void(const Sweep&)>;
+
+    protected:
+
+    Sweep    sweep_;
+    Callback callback_;
+
+    public:
+
+    SweepAssembler(const Callback& callback = Callback()) :
+        callback_(callback)
+    {}
+
+    void set_callback(const Callback& callback) { callback_ = callback; }
+    const Sweep& current() const { return sweep_; }
+
+    void flush() {
+        if(!sweep_.empty() && callback_) {
+            callback_(sweep_);
+        }
+        sweep_.clear();
+    }
+
+    void add_row(const DeviceData& row) {
+        if(!sweep_.same_geometry(row.ping_parameters())) {
+            this->flush();
+            sweep_.reset(row.ping_parameters().number_of_samples);
+        }
+        else if(sweep_.has_row(row.ping_parameters().angle)) {
+            this->flush();
+        }
+        sweep_.insert(row);
+    }
+};
+
+} //namespace ping360
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_PING360_SWEEP_H_
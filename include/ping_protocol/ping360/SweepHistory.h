@@ -0,0 +1,181 @@
+#ifndef _DEF_PING_PROTOCOL_PING360_SWEEP_HISTORY_H_
+#define _DEF_PING_PROTOCOL_PING360_SWEEP_HISTORY_H_
+
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <mutex>
+
+#include <ping_protocol/messages/Ping360Messages.h>
+#include <ping_protocol/ping360/Sweep.h>
+
+namespace ping_protocol { namespace ping360 {
+
+/**
+ * Time-indexed history of ping360::DeviceData rows with a fixed memory
+ * footprint.
+ *
+ * Rows are copied in preallocated rings (one fixed size slot per row, nothing
+ * is allocated on insertion). Rows leaving the hot ring are moved to an
+ * optional cold ring where samples are max-decimated and quantized on fewer
+ * bits. Rows are inserted in time order, so time queries are binary searches
+ * in the rings. For angle queries each row is linked to the previous row of
+ * the same angle in its ring, with skew-binary jump links (Myers 1983) to
+ * search these lists in O(log n) time.
+ *
+ * Rows longer than maxSamples are truncated. All methods are thread-safe.
+ */
+class SweepHistory
+{
+    public:
+
+    using Ptr      = std::shared_ptr<SweepHistory>;
+    using ConstPtr = std::shared_ptr<const SweepHistory>;
+
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr unsigned int AngleCount = Sweep::AngleCount;
+
+    struct Config {
+        unsigned int hotCapacity;     // rows
+        unsigned int coldCapacity;    // rows, 0 disables the cold tier
+        uint16_t     maxSamples;
+        unsigned int coldBits;        // 1, 2, 4 or 8 bits per sample
+        unsigned int coldDecimation;  // samples merged in the cold tier
+    };
+
+    static Config default_config() {
+        Config res;
+        res.hotCapacity     = 4000;  // 10 full turns at 1 gradian step
+        res.coldCapacity    = 40000;
+        res.maxSamples      = 1200;
+        res.coldBits        = 4;
+        res.coldDecimation  = 2;
+        return res;
+    }
+
+    struct Row {
+        Clock::time_point    timestamp;
+        PingParameters       parameters;
+        std::vector<uint8_t> samples; // number_of_samples, truncated to maxSamples
+        bool                 cold;
+    };
+
+    protected:
+
+    struct Record {
+        uint64_t       seq;
+        Clock::rep     timestamp;
+        PingParameters parameters;
+        uint16_t       sampleCount;
+        // previous row of the same angle and jump link in the same tier,
+        // depths are counted from the oldest linked row of the angle.
+        uint64_t       previous;
+        uint64_t       jump;
+        uint64_t       depth;
+        uint64_t       jumpDepth;
+    };
+
+    static constexpr uint64_t NotFound = ~(uint64_t)0;
+
+    class Tier
+    {
+        protected:
+
+        unsigned int          capacity_;
+        unsigned int          bits_;
+        unsigned int          decimation_;
+        std::size_t           slotSize_;
+        std::vector<Record>   records_;
+        std::vector<uint8_t>  slab_;
+        uint64_t              begin_; // oldest valid sequence number
+        uint64_t              end_;   // next sequence number
+        std::vector<uint64_t> last_;  // last row of each angle
+
+        bool contains(uint64_t seq) const { return seq >= begin_ && seq < end_; }
+        void link(Record& record, uint64_t previous) const;
+
+        public:
+
+        Tier(unsigned int capacity, uint16_t maxSamples,
+             unsigned int bits, unsigned int decimation);
+
+        unsigned int capacity() const { return capacity_; }
+        std::size_t size() const { return end_ - begin_; }
+        bool full() const { return this->size() == capacity_; }
+        std::size_t memory_usage() const;
+
+        uint64_t begin() const { return begin_; }
+        uint64_t end()   const { return end_; }
+        const Record& record(uint64_t seq) const { return records_[seq % capacity_]; }
+        const uint8_t* slot(uint64_t seq) const { return slab_.data() + slotSize_*(seq % capacity_); }
+
+        void clear();
+        void push(Clock::rep timestamp, const PingParameters& params,
+                  const uint8_t* data, std::size_t count);
+        void decode(uint64_t seq, uint8_t* dst) const;
+        void read(uint64_t seq, Row& out) const;
+
+        // first row at or after timestamp
+        uint64_t lower_bound(Clock::rep timestamp) const;
+        // first row after timestamp
+        uint64_t upper_bound(Clock::rep timestamp) const;
+        // last row of angle at or before timestamp in this tier, NotFound if none
+        uint64_t find(unsigned int angle, Clock::rep timestamp) const;
+    };
+
+    Config             config_;
+    Tier               hot_;
+    Tier               cold_;
+    Clock::rep         lastTimestamp_;
+    mutable std::mutex mutex_;
+
+    bool find(unsigned int angle, Clock::rep timestamp, Row& out) const;
+    void query(const Tier& tier, Clock::rep t0, Clock::rep t1,
+               unsigned int angleBegin, unsigned int angleEnd,
+               std::vector<Row>& out, std::size_t& count) const;
+
+    public:
+
+    SweepHistory(const Config& config = default_config());
+
+    static Ptr Create(const Config& config = default_config());
+
+    const Config& config() const { return config_; }
+    std::size_t size() const;
+    std::size_t memory_usage() const;
+    void clear();
+
+    void insert(const DeviceData& row, Clock::time_point timestamp = Clock::now());
+
+    // Last row received for an angle.
+    bool latest(unsigned int angle, Row& out) const;
+    // Last row received for an angle at or before timestamp.
+    bool at(unsigned int angle, Clock::time_point timestamp, Row& out) const;
+
+    /**
+     * Rows received in [t0,t1] with an angle in [angleBegin,angleEnd), the
+     * angle range wraps around if angleBegin > angleEnd. Rows are written in
+     * time order in out, which is resized to the number of rows found (its
+     * elements are reused to avoid reallocations).
+     */
+    std::size_t query(Clock::time_point t0, Clock::time_point t1,
+                      std::vector<Row>& out,
+                      unsigned int angleBegin = 0,
+                      unsigned int angleEnd   = AngleCount) const;
+
+    /**
+     * Fills a sweep with the last row of each angle received in
+     * [timestamp - window, timestamp]. The sweep takes the geometry of the
+     * most recent row. Rows with a different geometry are ignored. Returns the
+     * number of rows inserted. buffer holds the decoded samples (resized to
+     * maxSamples, reuse it between calls to avoid reallocations).
+     */
+    unsigned int reconstruct(Clock::time_point timestamp, Clock::duration window,
+                             Sweep& out, std::vector<uint8_t>& buffer) const;
+};
+
+} //namespace ping360
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_PING360_SWEEP_HISTORY_H_
@@ -0,0 +1,112 @@
+#ifndef _DEF_PING_PROTOCOL_PING360_WEDGE_RENDERER_H_
+#define _DEF_PING_PROTOCOL_PING360_WEDGE_RENDERER_H_
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include <ping_protocol/messages/Ping360Messages.h>
+#include <ping_protocol/ping360/Sweep.h>
+
+namespace ping_protocol { namespace ping360 {
+
+/**
+ * Pixel rectangle [left, right) x [top, bottom).
+ */
+struct Rectangle
+{
+    unsigned int left;
+    unsigned int top;
+    unsigned int right;
+    unsigned int bottom;
+
+    static Rectangle Empty() { return Rectangle({0,0,0,0}); }
+
+    bool empty() const { return right <= left || bottom <= top; }
+    unsigned int width()  const { return this->empty() ? 0 : right - left; }
+    unsigned int height() const { return this->empty() ? 0 : bottom - top; }
+
+    Rectangle& merge(const Rectangle& other) {
+        if(other.empty()) {
+            return *this;
+        }
+        if(this->empty()) {
+            *this = other;
+            return *this;
+        }
+        left   = std::min(left,   other.left);
+        top    = std::min(top,    other.top);
+        right  = std::max(right,  other.right);
+        bottom = std::max(bottom, other.bottom);
+        return *this;
+    }
+};
+
+/**
+ * Incremental Cartesian rendering of ping360 data.
+ *
+ * The image is square, width() pixels wide, row-major, with the sonar at its
+ * center, angle 0 pointing up and angles increasing clockwise. The image
+ * radius spans the number_of_samples of the current geometry.
+ *
+ * For each angle the list of covered pixels (and the sample each one reads)
+ * is precomputed once per geometry, so rendering a ping only touches the
+ * pixels of its wedge. A ping at angle a with an angle step s covers the s
+ * angles centered on a.
+ */
+class WedgeRenderer
+{
+    public:
+
+    using Ptr      = std::shared_ptr<WedgeRenderer>;
+    using ConstPtr = std::shared_ptr<const WedgeRenderer>;
+
+    static constexpr unsigned int AngleCount = Sweep::AngleCount;
+
+    protected:
+
+    unsigned int         width_;
+    unsigned int         angleStep_;
+    float                soundSpeed_;
+    uint16_t             sampleCount_;
+    uint16_t             samplePeriod_;
+    std::vector<uint8_t> image_;
+
+    // Pixels of angle n are pixels_[offsets_[n]] to pixels_[offsets_[n+1]-1].
+    std::vector<uint32_t>  offsets_;
+    std::vector<uint32_t>  pixels_;
+    std::vector<uint16_t>  samples_;
+    std::vector<Rectangle> bounds_;
+
+    void update_geometry(uint16_t sampleCount);
+
+    public:
+
+    WedgeRenderer(unsigned int width, unsigned int angleStep = 1,
+                  float soundSpeed = 1500.0f);
+
+    static Ptr Create(unsigned int width, unsigned int angleStep = 1,
+                      float soundSpeed = 1500.0f);
+
+    unsigned int width()        const { return width_; }
+    unsigned int angle_step()   const { return angleStep_; }
+    uint16_t     sample_count() const { return sampleCount_; }
+    const uint8_t* image() const { return image_.data(); }
+    Rectangle full_image() const { return Rectangle({0,0,width_,width_}); }
+
+    // Distance covered by the image radius and size of a pixel, in meters.
+    float range() const;
+    float resolution() const { return 2.0f*this->range() / width_; }
+
+    void set_angle_step(unsigned int angleStep);
+    void clear();
+
+    Rectangle wedge_bounds(unsigned int angle) const;
+    Rectangle render(const DeviceData& row);
+    Rectangle render(const Sweep& sweep);
+};
+
+} //namespace ping360
+} //namespace ping_protocol
+
+#endif //_DEF_PING_PROTOCOL_PING360_WEDGE_RENDERER_H_
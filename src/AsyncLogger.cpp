@@ -0,0 +1,126 @@
+#include <ping_protocol/AsyncLogger.h>
+
+#include <sstream>
+#include <cerrno>
+#include <chrono>
+
+namespace ping_protocol {
+
+AsyncLogger::AsyncLogger(int fd, LogFormat format,
+                         unsigned int slotCount, unsigned int slotSize) :
+    fd_(fd),
+    format_(format),
+    slotCount_(slotCount),
+    slotSize_(slotSize),
+    slots_(slotCount*slotSize),
+    sizes_(slotCount),
+    head_(0),
+    tail_(0),
+    droppedCount_(0),
+    // formatted lines are batched before being written
+    output_(64*1024),
+    running_(true)
+{
+    if(slotCount_ == 0 || slotSize_ < sizeof(MessageHeader)) {
+        std::ostringstream oss;
+        oss << "AsyncLogger : invalid ring dimensions ("
+            << slotCount << " slots of " << slotSize << " bytes)";
+        throw std::runtime_error(oss.str());
+    }
+    thread_ = std::thread(&AsyncLogger::run, this);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    wakeUp_.notify_one();
+    thread_.join();
+}
+
+AsyncLogger::Ptr AsyncLogger::Create(int fd, LogFormat format,
+                                     unsigned int slotCount,
+                                     unsigned int slotSize)
+{
+    return Ptr(new AsyncLogger(fd, format, slotCount, slotSize));
+}
+
+bool AsyncLogger::log(const Message& msg)
+{
+    return this->log(msg.data(), msg.size());
+}
+
+bool AsyncLogger::log(const uint8_t* frame, std::size_t size)
+{
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if(head - tail_.load(std::memory_order_acquire) >= slotCount_) {
+        droppedCount_++;
+        return false;
+    }
+    unsigned int slot = head % slotCount_;
+    size = std::min<std::size_t>(size, slotSize_);
+    std::memcpy(slots_.data() + slot*slotSize_, frame, size);
+    sizes_[slot] = size;
+    head_.store(head + 1, std::memory_order_release);
+
+    // No lock here : the logger thread also wakes up periodically, so a
+    // missed notification only delays the output.
+    wakeUp_.notify_one();
+    return true;
+}
+
+void AsyncLogger::write_output(std::size_t size)
+{
+    const char* data = output_.data();
+    while(size > 0) {
+        auto written = ::write(fd_, data, size);
+        if(written < 0) {
+            if(errno == EINTR) continue;
+            return; // nowhere to report this, the log is lost
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+void AsyncLogger::run()
+{
+    // Longest line formatted from a slot. Lines are flushed before the
+    // output buffer gets less room than this.
+    const std::size_t maxLine = 4*slotSize_ + 512;
+    if(output_.size() < 2*maxLine) {
+        output_.resize(2*maxLine);
+    }
+
+    for(;;) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        uint64_t head = head_.load(std::memory_order_acquire);
+        if(tail == head) {
+            if(!running_) {
+                break;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            wakeUp_.wait_for(lock, std::chrono::milliseconds(10));
+            continue;
+        }
+
+        std::size_t size = 0;
+        for(; tail != head; tail++) {
+            unsigned int slot = tail % slotCount_;
+            size += format_message(output_.data() + size, output_.size() - size,
+                                   slots_.data() + slot*slotSize_, sizes_[slot],
+                                   format_);
+            if(output_.size() - size < maxLine) {
+                tail_.store(tail + 1, std::memory_order_release);
+                this->write_output(size);
+                size = 0;
+            }
+        }
+        tail_.store(tail, std::memory_order_release);
+        this->write_output(size);
+    }
+}
+
+} //namespace ping_protocol
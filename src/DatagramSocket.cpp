@@ -0,0 +1,176 @@
+#include <ping_protocol/DatagramSocket.h>
+#include <ping_protocol/messages/frame_utils.h>
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+namespace ping_protocol {
+
+DatagramSocket::DatagramSocket(const std::string& remoteIP, uint16_t remotePort,
+                               unsigned int batchSize, unsigned int datagramSize) :
+    remoteIP_(remoteIP),
+    remotePort_(remotePort),
+    socket_(-1),
+    running_(false),
+    batchSize_(batchSize),
+    datagramSize_(datagramSize),
+    buffers_(batchSize*datagramSize),
+    iovecs_(batchSize),
+    headers_(batchSize)
+{
+    std::memset(&stats_, 0, sizeof(stats_));
+
+    for(unsigned int n = 0; n < batchSize_; n++) {
+        iovecs_[n].iov_base = buffers_.data() + n*datagramSize_;
+        iovecs_[n].iov_len  = datagramSize_;
+        std::memset(&headers_[n], 0, sizeof(mmsghdr));
+        headers_[n].msg_hdr.msg_iov    = &iovecs_[n];
+        headers_[n].msg_hdr.msg_iovlen = 1;
+    }
+    this->open_socket();
+}
+
+void DatagramSocket::open_socket()
+{
+    sockaddr_in remote;
+    std::memset(&remote, 0, sizeof(remote));
+    remote.sin_family = AF_INET;
+    remote.sin_port   = htons(remotePort_);
+    if(inet_pton(AF_INET, remoteIP_.c_str(), &remote.sin_addr) != 1) {
+        std::ostringstream oss;
+        oss << "DatagramSocket : invalid remote address '" << remoteIP_ << "'";
+        throw std::runtime_error(oss.str());
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(fd < 0) {
+        std::ostringstream oss;
+        oss << "DatagramSocket : could not create socket ("
+            << std::strerror(errno) << ')';
+        throw std::runtime_error(oss.str());
+    }
+    // The receive thread wakes up periodically to check for stop().
+    timeval timeout = {0, 100000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    if(connect(fd, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote)) != 0) {
+        int err = errno;
+        close(fd);
+        std::ostringstream oss;
+        oss << "DatagramSocket : could not connect to "
+            << remoteIP_ << ':' << remotePort_ << " (" << std::strerror(err) << ')';
+        throw std::runtime_error(oss.str());
+    }
+    socket_ = fd;
+}
+
+DatagramSocket::~DatagramSocket()
+{
+    this->stop();
+    if(socket_ >= 0) {
+        close(socket_);
+    }
+}
+
+DatagramSocket::Ptr DatagramSocket::Create(const std::string& remoteIP,
+                                           uint16_t remotePort,
+                                           unsigned int batchSize,
+                                           unsigned int datagramSize)
+{
+    return Ptr(new DatagramSocket(remoteIP, remotePort, batchSize, datagramSize));
+}
+
+ssize_t DatagramSocket::send(const uint8_t* data, std::size_t size)
+{
+    return ::send(socket_, data, size, 0);
+}
+
+void DatagramSocket::start(const FrameCallback& callback,
+                           const ErrorCallback& errorCallback)
+{
+    if(running_) {
+        return;
+    }
+    // the receive thread may have exited on an error
+    if(thread_.joinable()) {
+        thread_.join();
+    }
+    callback_      = callback;
+    errorCallback_ = errorCallback;
+    running_       = true;
+    thread_   = std::thread(&DatagramSocket::receive_loop, this);
+}
+
+void DatagramSocket::stop()
+{
+    running_ = false;
+    if(thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void DatagramSocket::reopen()
+{
+    this->stop();
+    if(socket_ >= 0) {
+        close(socket_);
+        socket_ = -1;
+    }
+    this->open_socket();
+}
+
+void DatagramSocket::receive_loop()
+{
+    while(running_) {
+        // MSG_WAITFORONE : blocks until a first datagram is available, then
+        // takes whatever else is already queued without blocking.
+        int count = recvmmsg(socket_, headers_.data(), batchSize_,
+                             MSG_WAITFORONE, nullptr);
+        if(count < 0) {
+            if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                continue;
+            }
+            if(errno == ECONNREFUSED) {
+                // ICMP port unreachable from a previous send. The device
+                // might not be up yet.
+                continue;
+            }
+            int err = errno;
+            running_ = false;
+            if(errorCallback_) {
+                errorCallback_(err);
+            }
+            else {
+                std::cerr << "DatagramSocket::receive_loop : got socket error ("
+                          << std::strerror(err) << ')' << std::endl;
+            }
+            break;
+        }
+        stats_.syscalls++;
+        for(int n = 0; n < count; n++) {
+            if(headers_[n].msg_hdr.msg_flags & MSG_TRUNC) {
+                stats_.truncated++;
+            }
+            this->process_datagram(buffers_.data() + n*datagramSize_,
+                                   headers_[n].msg_len);
+        }
+    }
+}
+
+void DatagramSocket::process_datagram(const uint8_t* data, std::size_t size)
+{
+    stats_.datagrams++;
+    stats_.skippedBytes += for_each_frame(data, size,
+        [this](const uint8_t* frame, std::size_t frameSize) {
+            stats_.frames++;
+            callback_(frame, frameSize);
+        });
+}
+
+} //namespace ping_protocol
@@ -1,34 +1,219 @@
 #include <ping_protocol/PingClient.h>
 #include <ping_protocol/messages/print_utils.h>
+#include <ping_protocol/messages/format_utils.h>
+#include <ping_protocol/messages/generated_layouts.h>
 
 #include <iostream>
+#include <cerrno>
 
 namespace ping_protocol {
 
 // allows to use _1, _2 ...
 using namespace std::placeholders;
 
+namespace {
+
+// Fields the client reads before forwarding a message, visited with the
+// generated dispatch. Other messages are only forwarded.
+struct Inspected
+{
+    bool     version    = false;
+    bool     deviceData = false;
+    uint16_t angle      = 0;
+
+    void operator()(const generated::common::ProtocolVersion&) { version = true; }
+    void operator()(const generated::ping360::DeviceData& msg) {
+        deviceData = true;
+        angle      = msg.angle();
+    }
+    template <class T> void operator()(const T&) {}
+};
+
+} //namespace
+
 PingClient::PingClient(rtac::asio::Stream::Ptr stream) :
     stream_(stream),
     incomingMessage_(0,0)
 {
-    this->initiate_connection();
+    this->init_supervisor();
+}
+
+PingClient::PingClient(const StreamFactory& streamFactory) :
+    streamFactory_(streamFactory),
+    stream_(streamFactory()),
+    incomingMessage_(0,0)
+{
+    this->init_supervisor();
+}
+
+PingClient::PingClient(const DatagramSocket::Ptr& socket) :
+    datagram_(socket),
+    incomingMessage_(0, socket->datagram_size())
+{
+    this->init_supervisor();
+}
+
+PingClient::~PingClient()
+{
+    this->stop();
 }
 
 PingClient::Ptr PingClient::CreateUDP(const std::string& remoteIP, uint16_t remotePort)
 {
-    return Ptr(new PingClient(rtac::asio::Stream::CreateUDPClient(remoteIP, remotePort)));
+    Ptr client(new PingClient([remoteIP, remotePort]() {
+        return rtac::asio::Stream::CreateUDPClient(remoteIP, remotePort);
+    }));
+    client->start();
+    return client;
 }
 
 PingClient::Ptr PingClient::CreateSerial(const std::string& device, unsigned int baudrate)
 {
-    return Ptr(new PingClient(rtac::asio::Stream::CreateSerial(device, baudrate)));
+    Ptr client(new PingClient([device, baudrate]() {
+        return rtac::asio::Stream::CreateSerial(device, baudrate);
+    }));
+    client->start();
+    return client;
+}
+
+PingClient::Ptr PingClient::CreateUDPDatagram(const std::string& remoteIP,
+                                              uint16_t remotePort,
+                                              unsigned int batchSize,
+                                              unsigned int datagramSize)
+{
+    Ptr client(new PingClient(DatagramSocket::Create(remoteIP, remotePort,
+                                                     batchSize, datagramSize)));
+    client->start();
+    return client;
+}
+
+void PingClient::init_supervisor()
+{
+    generation_       = 0;
+    readPending_      = false;
+    config_           = default_supervisor_config();
+    state_            = Disconnected;
+    waitingFirstPing_ = true;
+    keepAlivePending_ = false;
+    lastAngle_        = -1;
+    running_          = false;
+    stopped_          = false;
+    reopenNeeded_     = false;
+    restorePending_   = false;
+    failedHandshakes_ = 0;
+    backoff_          = config_.backoffMin;
+    std::memset(&stats_, 0, sizeof(stats_));
+    hasTransducerConfig_ = false;
+
+    auto now = Clock::now();
+    nextAttempt_   = now;
+    lastKeepAlive_ = now;
+    lossTime_      = now;
+    lastActivity_  = now.time_since_epoch().count();
+}
+
+void PingClient::start()
+{
+    {
+        std::lock_guard<std::mutex> lock(supervisorMutex_);
+        if(running_ || stopped_) {
+            return;
+        }
+        running_ = true;
+    }
+    unsigned int generation;
+    {
+        std::lock_guard<std::mutex> lock(streamMutex_);
+        generation = generation_;
+    }
+    if(datagram_) {
+        this->start_datagram(generation);
+    }
+    else {
+        this->get_header(generation);
+    }
+    supervisor_ = std::thread(&PingClient::supervise, this);
+}
+
+void PingClient::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(supervisorMutex_);
+        running_ = false;
+        stopped_ = true;
+    }
+    supervisorWakeUp_.notify_all();
+    if(supervisor_.joinable()) {
+        supervisor_.join();
+    }
+    if(datagram_) {
+        datagram_->stop();
+    }
+
+    // Pending callbacks of the stream become stale before it is destroyed.
+    rtac::asio::Stream::Ptr stream;
+    {
+        std::lock_guard<std::mutex> lock(streamMutex_);
+        stream.swap(stream_);
+        generation_++;
+        readPending_ = false;
+    }
+}
+
+void PingClient::set_supervisor_config(const SupervisorConfig& config)
+{
+    {
+        std::lock_guard<std::mutex> lock(supervisorMutex_);
+        config_  = config;
+        backoff_ = config_.backoffMin;
+    }
+    supervisorWakeUp_.notify_all();
+}
+
+PingClient::ConnectionStats PingClient::connection_stats()
+{
+    std::lock_guard<std::mutex> lock(supervisorMutex_);
+    return stats_;
 }
 
 void PingClient::send(const Message& msg)
 {
+    // Keeping the last transducer configuration to restore it after a
+    // reconnection.
+    if(msg.header().message_id == ping360::Transducer::MessageId) {
+        std::lock_guard<std::mutex> lock(configMutex_);
+        transducerConfig_ = reinterpret_cast<const ping360::Transducer&>(msg).config();
+        hasTransducerConfig_ = true;
+    }
+    else if(msg.header().message_id == ping360::MotorOff::MessageId) {
+        std::lock_guard<std::mutex> lock(configMutex_);
+        hasTransducerConfig_ = false;
+    }
+
+    // The supervisor sends from its own thread, frames must not interleave.
+    std::lock_guard<std::mutex> writeLock(writeMutex_);
+    if(datagram_) {
+        auto sent = datagram_->send(msg.data(), msg.size());
+        if(sent < 0 || (std::size_t)sent != msg.size()) {
+            std::ostringstream oss;
+            oss << "PingClient : could not send datagram ("
+                << (sent < 0 ? std::strerror(errno) : "truncated") << ')';
+            throw std::runtime_error(oss.str());
+        }
+        return;
+    }
+
+    rtac::asio::Stream::Ptr stream;
+    {
+        std::lock_guard<std::mutex> lock(streamMutex_);
+        stream = stream_;
+    }
+    if(!stream) {
+        throw std::runtime_error("PingClient : could not send message (stream not open)");
+    }
+
     // synchronous write
-    auto sent = stream_->write(msg.size(), msg.data());
+    auto sent = stream->write(msg.size(), msg.data());
     if(sent != msg.size()) {
         std::ostringstream oss;
         oss << "PingClient : could not send full message ("
@@ -39,72 +224,421 @@ void PingClient::send(const Message& msg)
 
 void PingClient::initiate_connection()
 {
-    stream_->async_read(protocolVersion_.size(), protocolVersion_.data(),
-        std::bind(&PingClient::initiate_callback, this, _1, _2));
-    this->send(GeneralRequest(5));
+    {
+        std::lock_guard<std::mutex> lock(supervisorMutex_);
+        state_            = Disconnected;
+        failedHandshakes_ = 0;
+        backoff_          = config_.backoffMin;
+        nextAttempt_      = Clock::now();
+    }
+    supervisorWakeUp_.notify_all();
 }
 
-void PingClient::initiate_callback(const ErrorCode& err, std::size_t byteCount)
+void PingClient::supervise()
 {
-    if(err) {
-        std::ostringstream oss;
-        oss << "PingClient::initiate_callback : got stream error ("
-            << err << ')';
-        throw std::runtime_error(oss.str());
+    // Messages are sent with the lock released : a blocking write must not
+    // hold back the stream callbacks or the users of the client.
+    enum Action { None, Handshake, Restore, KeepAlive };
+
+    std::unique_lock<std::mutex> lock(supervisorMutex_);
+    while(running_) {
+        auto now    = Clock::now();
+        auto wakeUp = now + config_.linkTimeout;
+        Action action = None;
+
+        switch(state_) {
+            case Disconnected:
+                if(now < nextAttempt_) {
+                    wakeUp = nextAttempt_;
+                    break;
+                }
+                if(reopenNeeded_) {
+                    // Stream callbacks may need the supervisor lock while the
+                    // stream is being closed.
+                    lock.unlock();
+                    this->reopen_stream();
+                    lock.lock();
+                    now = Clock::now();
+                    if(reopenNeeded_) {
+                        nextAttempt_ = now + backoff_;
+                        backoff_     = std::min(2*backoff_, config_.backoffMax);
+                        wakeUp       = nextAttempt_;
+                        break;
+                    }
+                }
+                this->start_handshake(now);
+                action = Handshake;
+                break;
+
+            case Handshaking:
+                if(now < handshakeDeadline_) {
+                    wakeUp = handshakeDeadline_;
+                    break;
+                }
+                std::cerr << "PingClient : handshake timeout" << std::endl;
+                state_ = Disconnected;
+                if(++failedHandshakes_ >= config_.handshakeAttempts) {
+                    failedHandshakes_ = 0;
+                    reopenNeeded_     = true;
+                }
+                nextAttempt_ = now + backoff_;
+                backoff_     = std::min(2*backoff_, config_.backoffMax);
+                wakeUp       = nextAttempt_;
+                break;
+
+            case Connected: {
+                if(restorePending_) {
+                    restorePending_ = false;
+                    action = Restore;
+                    break;
+                }
+                auto lastActivity = Clock::time_point(Clock::duration(lastActivity_));
+                auto halfTimeout  = config_.linkTimeout / 2;
+                if(now - lastActivity >= config_.linkTimeout) {
+                    std::cerr << "PingClient : link lost (no incoming data)" << std::endl;
+                    state_            = Disconnected;
+                    reopenNeeded_     = true;
+                    lossTime_         = now;
+                    waitingFirstPing_ = true;
+                    backoff_          = config_.backoffMin;
+                    nextAttempt_      = now;
+                    stats_.linkLossCount++;
+                    wakeUp = now;
+                    break;
+                }
+                if(now - lastActivity >= halfTimeout && now - lastKeepAlive_ >= halfTimeout) {
+                    // The device is idle (not pinging), checking it is still there.
+                    lastKeepAlive_    = now;
+                    keepAlivePending_ = true;
+                    action = KeepAlive;
+                    break;
+                }
+                wakeUp = std::min(lastActivity + config_.linkTimeout,
+                                  std::max(lastActivity, lastKeepAlive_) + halfTimeout);
+                break;
+            }
+        }
+
+        if(action != None) {
+            lock.unlock();
+            if(action == Restore) {
+                this->restore_state();
+            }
+            else {
+                this->send_request(GeneralRequest(5));
+            }
+            lock.lock();
+            continue; // state re-evaluated, it may have changed meanwhile
+        }
+
+        if(running_ && wakeUp > now) {
+            supervisorWakeUp_.wait_until(lock, wakeUp);
+        }
+    }
+}
+
+void PingClient::reopen_stream()
+{
+    unsigned int generation;
+    if(streamFactory_) {
+        rtac::asio::Stream::Ptr previous;
+        {
+            std::lock_guard<std::mutex> lock(streamMutex_);
+            previous.swap(stream_);
+            generation_++;
+            readPending_ = false;
+        }
+        // Closing the previous stream outside the lock. Its pending
+        // callbacks are ignored as they belong to a previous generation.
+        previous.reset();
+
+        rtac::asio::Stream::Ptr stream;
+        try {
+            stream = streamFactory_();
+        }
+        catch(const std::exception& e) {
+            std::cerr << "PingClient : could not reopen stream (" << e.what() << ')'
+                      << std::endl;
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(streamMutex_);
+            stream_    = stream;
+            generation = generation_;
+        }
+        std::lock_guard<std::mutex> lock(supervisorMutex_);
+        reopenNeeded_ = false;
+        stats_.reopenCount++;
     }
-    else if(byteCount != ProtocolVersion::FixedSize || !protocolVersion_.is_valid()) {
-        std::cerr << "PingClient::initiate_callback : invalid ProtocolVersion message"
-                  << std::endl;
-        this->initiate_connection();
+    else if(datagram_) {
+        // The receive thread is stopped first, it may be calling send()
+        // from message_callback.
+        datagram_->stop();
+        {
+            std::lock_guard<std::mutex> lock(streamMutex_);
+            generation_++;
+            generation = generation_;
+        }
+        try {
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            datagram_->reopen();
+        }
+        catch(const std::exception& e) {
+            std::cerr << "PingClient : could not reopen socket (" << e.what() << ')'
+                      << std::endl;
+            return;
+        }
+        this->start_datagram(generation);
+        std::lock_guard<std::mutex> lock(supervisorMutex_);
+        reopenNeeded_ = false;
+        stats_.reopenCount++;
+        return;
     }
     else {
-        // valid connection
-        std::cout << protocolVersion_ << std::endl;
-        this->get_header();
+        // Stream cannot be reopened, only making sure a read is pending.
+        {
+            std::lock_guard<std::mutex> lock(streamMutex_);
+            generation = generation_;
+        }
+        std::lock_guard<std::mutex> lock(supervisorMutex_);
+        reopenNeeded_ = false;
+    }
+    this->get_header(generation);
+}
+
+void PingClient::start_handshake(Clock::time_point now)
+{
+    // supervisorMutex_ must be locked, the request is sent by the caller
+    // after releasing it.
+    state_             = Handshaking;
+    handshakeDeadline_ = now + config_.handshakeTimeout;
+}
+
+void PingClient::send_request(const Message& msg)
+{
+    try {
+        this->send(msg);
+    }
+    catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
     }
 }
 
-void PingClient::get_header()
+void PingClient::restore_state()
 {
+    ping360::Transducer::Config config;
+    {
+        std::lock_guard<std::mutex> lock(configMutex_);
+        if(!hasTransducerConfig_) {
+            return;
+        }
+        config = transducerConfig_;
+    }
+    int lastAngle = lastAngle_;
+    if(lastAngle >= 0) {
+        config.angle = lastAngle;
+    }
+    this->send_request(ping360::Transducer(config));
+}
+
+void PingClient::link_lost(unsigned int generation, const char* reason)
+{
+    {
+        std::lock_guard<std::mutex> lock(streamMutex_);
+        if(generation != generation_) {
+            return;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(supervisorMutex_);
+        if(reopenNeeded_) {
+            return; // already handled
+        }
+        std::cerr << "PingClient : link lost (" << reason << ')' << std::endl;
+        auto now = Clock::now();
+        if(state_ == Connected) {
+            lossTime_         = now;
+            waitingFirstPing_ = true;
+            stats_.linkLossCount++;
+            // first attempt right away
+            backoff_     = config_.backoffMin;
+            nextAttempt_ = now;
+        }
+        else {
+            // Lost again while reconnecting, backing off.
+            nextAttempt_ = now + backoff_;
+            backoff_     = std::min(2*backoff_, config_.backoffMax);
+        }
+        state_        = Disconnected;
+        reopenNeeded_ = true;
+    }
+    supervisorWakeUp_.notify_all();
+}
+
+void PingClient::mark_activity()
+{
+    lastActivity_ = Clock::now().time_since_epoch().count();
+}
+
+void PingClient::get_header(unsigned int generation)
+{
+    std::lock_guard<std::mutex> lock(streamMutex_);
+    if(generation != generation_ || !stream_ || readPending_) {
+        return;
+    }
+    readPending_ = true;
     stream_->async_read(sizeof(incomingHeader_), (uint8_t*)&incomingHeader_,
-        std::bind(&PingClient::header_callback, this, _1, _2));
+        std::bind(&PingClient::header_callback, this, generation, _1, _2));
 }
 
-void PingClient::header_callback(const ErrorCode& err, std::size_t byteCount)
+void PingClient::header_callback(unsigned int generation,
+                                 const ErrorCode& err, std::size_t byteCount)
 {
+    {
+        std::lock_guard<std::mutex> lock(streamMutex_);
+        if(generation != generation_) {
+            return;
+        }
+        readPending_ = false;
+    }
     if(err) {
         std::ostringstream oss;
         oss << "PingClient::header_callback : got stream error ("
             << err << ')';
-        throw std::runtime_error(oss.str());
+        this->link_lost(generation, oss.str().c_str());
     }
     else if(byteCount != sizeof(incomingHeader_) || !incomingHeader_.is_valid()) {
         std::cerr << "Invalid Header" << std::endl << std::flush;
-        this->get_header();
+        this->get_header(generation);
     }
     else {
         incomingMessage_.accomodate_for_message(incomingHeader_);
+        std::lock_guard<std::mutex> lock(streamMutex_);
+        if(generation != generation_ || !stream_) {
+            return;
+        }
+        readPending_ = true;
         stream_->async_read(incomingHeader_.payload_length + 2,
                             incomingMessage_.payload(),
-                            std::bind(&PingClient::payload_callback, this, _1, _2));
+                            std::bind(&PingClient::payload_callback, this,
+                                      generation, _1, _2));
     }
 }
 
-void PingClient::payload_callback(const ErrorCode& err, std::size_t byteCount)
+void PingClient::payload_callback(unsigned int generation,
+                                  const ErrorCode& err, std::size_t byteCount)
 {
+    {
+        std::lock_guard<std::mutex> lock(streamMutex_);
+        if(generation != generation_) {
+            return;
+        }
+        readPending_ = false;
+    }
     if(err) {
         std::ostringstream oss;
         oss << "PingClient::payload_callback : got stream error ("
             << err << ')';
-        throw std::runtime_error(oss.str());
+        this->link_lost(generation, oss.str().c_str());
+        return;
+    }
+    if(incomingMessage_.checksum_valid()) {
+        this->mark_activity();
+        this->dispatch(incomingMessage_);
     }
-    this->message_callback(incomingMessage_);
-    this->get_header();
+    else {
+        std::cerr << "Invalid checksum" << std::endl << std::flush;
+    }
+    this->get_header(generation);
+}
+
+void PingClient::start_datagram(unsigned int generation)
+{
+    datagram_->start(std::bind(&PingClient::datagram_callback, this, _1, _2),
+                     std::bind(&PingClient::datagram_error, this, generation, _1));
+}
+
+void PingClient::datagram_error(unsigned int generation, int err)
+{
+    std::ostringstream oss;
+    oss << "DatagramSocket : got socket error (" << std::strerror(err) << ')';
+    this->link_lost(generation, oss.str().c_str());
+}
+
+void PingClient::datagram_callback(const uint8_t* frame, std::size_t size)
+{
+    // Frames are already validated in place. The Message buffer is
+    // preallocated for a full datagram so this never allocates.
+    incomingMessage_.accomodate_for_message(*reinterpret_cast<const MessageHeader*>(frame));
+    std::memcpy(incomingMessage_.data(), frame, size);
+    this->mark_activity();
+    this->dispatch(incomingMessage_);
+}
+
+void PingClient::connected()
+{
+    {
+        std::lock_guard<std::mutex> lock(supervisorMutex_);
+        if(state_ != Handshaking) {
+            return;
+        }
+        state_            = Connected;
+        failedHandshakes_ = 0;
+        backoff_          = config_.backoffMin;
+        // only restoring after a reconnection
+        restorePending_   = stats_.connectionCount > 0;
+        stats_.connectionCount++;
+        stats_.lastTimeToConnect = Clock::now() - lossTime_;
+    }
+    supervisorWakeUp_.notify_all();
+}
+
+void PingClient::dispatch(const Message& msg)
+{
+    Inspected inspected;
+    if(!generated::common::dispatch(msg.data(), msg.size(), inspected)) {
+        generated::ping360::dispatch(msg.data(), msg.size(), inspected);
+    }
+
+    if(inspected.version && (state_ != Connected || keepAlivePending_)) {
+        // Answer to a handshake or keep-alive request, not forwarded.
+        {
+            std::lock_guard<std::mutex> lock(versionMutex_);
+            std::memcpy(protocolVersion_.data(), msg.data(), msg.size());
+        }
+        keepAlivePending_ = false;
+        if(state_ == Handshaking) {
+            std::cout << reinterpret_cast<const ProtocolVersion&>(msg) << std::endl;
+            this->connected();
+        }
+        return;
+    }
+    if(state_ == Handshaking) {
+        // Any valid message shows the link is up.
+        this->connected();
+    }
+
+    if(inspected.deviceData) {
+        lastAngle_ = inspected.angle;
+        if(waitingFirstPing_.exchange(false)) {
+            std::lock_guard<std::mutex> lock(supervisorMutex_);
+            stats_.lastTimeToFirstPing = Clock::now() - lossTime_;
+        }
+    }
+    this->message_callback(msg);
+}
+
+ProtocolVersion PingClient::protocol_version() const
+{
+    std::lock_guard<std::mutex> lock(versionMutex_);
+    return protocolVersion_;
 }
 
 void PingClient::message_callback(const Message& msg) const
 {
-    print(std::cout, msg) << std::endl;
+    // Compact single line, formatted without allocation.
+    char line[512];
+    std::cout.write(line, format_message(line, sizeof(line), msg));
 }
 
 } //namespace ping_protocol
@@ -0,0 +1,402 @@
+#include <ping_protocol/PingProxy.h>
+#include <ping_protocol/messages/frame_utils.h>
+
+#include <iostream>
+#include <sstream>
+#include <cerrno>
+
+#include <unistd.h>
+
+namespace ping_protocol {
+
+PingProxy::PingProxy(const StreamFactory& streamFactory, const ProxyConfig& config) :
+    PingClient(streamFactory),
+    proxyConfig_(config),
+    socket_(-1),
+    proxyRunning_(false),
+    leaseHolder_(-1),
+    buffers_(config.batchSize*config.datagramSize),
+    iovecs_(config.batchSize),
+    addresses_(config.batchSize),
+    headers_(config.batchSize),
+    command_(0, config.datagramSize)
+{
+    sockaddr_un local;
+    std::memset(&local, 0, sizeof(local));
+    local.sun_family = AF_UNIX;
+    if(proxyConfig_.socketPath.size() >= sizeof(local.sun_path)) {
+        std::ostringstream oss;
+        oss << "PingProxy : socket path too long '" << proxyConfig_.socketPath << "'";
+        throw std::runtime_error(oss.str());
+    }
+    std::strcpy(local.sun_path, proxyConfig_.socketPath.c_str());
+
+    socket_ = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if(socket_ < 0) {
+        std::ostringstream oss;
+        oss << "PingProxy : could not create socket (" << std::strerror(errno) << ')';
+        throw std::runtime_error(oss.str());
+    }
+    // The receive thread wakes up periodically to check for stop().
+    timeval timeout = {0, 100000};
+    setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // A socket file left by a previous instance would make bind fail. It is
+    // only removed if no proxy answers on it.
+    int probe = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if(probe >= 0) {
+        int res = connect(probe, reinterpret_cast<const sockaddr*>(&local), sizeof(local));
+        int err = errno;
+        close(probe);
+        if(res == 0) {
+            close(socket_);
+            std::ostringstream oss;
+            oss << "PingProxy : a proxy is already running on '"
+                << proxyConfig_.socketPath << "'";
+            throw std::runtime_error(oss.str());
+        }
+        if(err == ECONNREFUSED) {
+            unlink(local.sun_path);
+        }
+    }
+    if(bind(socket_, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
+        int err = errno;
+        close(socket_);
+        std::ostringstream oss;
+        oss << "PingProxy : could not bind to '" << proxyConfig_.socketPath
+            << "' (" << std::strerror(err) << ')';
+        throw std::runtime_error(oss.str());
+    }
+
+    for(unsigned int n = 0; n < proxyConfig_.batchSize; n++) {
+        iovecs_[n].iov_base = buffers_.data() + n*proxyConfig_.datagramSize;
+        iovecs_[n].iov_len  = proxyConfig_.datagramSize;
+        std::memset(&headers_[n], 0, sizeof(mmsghdr));
+        headers_[n].msg_hdr.msg_iov    = &iovecs_[n];
+        headers_[n].msg_hdr.msg_iovlen = 1;
+    }
+    clients_.reserve(proxyConfig_.maxClients);
+
+    proxyRunning_ = true;
+    proxyThread_  = std::thread(&PingProxy::receive_loop, this);
+}
+
+PingProxy::~PingProxy()
+{
+    // Device link and receive thread stopped before clients_ is torn down,
+    // nothing is forwarded from now on.
+    this->stop();
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        while(!clients_.empty()) {
+            this->remove_client(clients_.size() - 1);
+        }
+    }
+    close(socket_);
+    unlink(proxyConfig_.socketPath.c_str());
+}
+
+PingProxy::Ptr PingProxy::CreateUDP(const std::string& remoteIP, uint16_t remotePort,
+                                    const ProxyConfig& config)
+{
+    Ptr proxy(new PingProxy([remoteIP, remotePort]() {
+        return rtac::asio::Stream::CreateUDPClient(remoteIP, remotePort);
+    }, config));
+    proxy->start();
+    return proxy;
+}
+
+PingProxy::Ptr PingProxy::CreateSerial(const std::string& device, unsigned int baudrate,
+                                       const ProxyConfig& config)
+{
+    Ptr proxy(new PingProxy([device, baudrate]() {
+        return rtac::asio::Stream::CreateSerial(device, baudrate);
+    }, config));
+    proxy->start();
+    return proxy;
+}
+
+void PingProxy::stop()
+{
+    PingClient::stop();
+    proxyRunning_ = false;
+    if(proxyThread_.joinable()) {
+        proxyThread_.join();
+    }
+}
+
+std::vector<PingProxy::ClientStats> PingProxy::client_stats() const
+{
+    std::lock_guard<std::mutex> lock(clientsMutex_);
+    std::vector<ClientStats> res(clients_.size());
+    for(unsigned int n = 0; n < clients_.size(); n++) {
+        res[n].name        = clients_[n].name;
+        res[n].priority    = clients_[n].priority;
+        res[n].leaseHolder = leaseHolder_ == (int)n && Clock::now() < leaseExpiry_;
+        res[n].forwarded   = clients_[n].forwarded;
+        res[n].dropped     = clients_[n].dropped;
+        res[n].commands    = clients_[n].commands;
+        res[n].rejected    = clients_[n].rejected;
+    }
+    return res;
+}
+
+void PingProxy::message_callback(const Message& msg) const
+{
+    // Called from the device link. The frame was parsed and validated once
+    // by PingClient and is sent from the same buffer to every client.
+    std::lock_guard<std::mutex> lock(clientsMutex_);
+    for(auto& client : clients_) {
+        if(client.disconnected) {
+            continue;
+        }
+        auto sent = ::send(client.socket, msg.data(), msg.size(),
+                           MSG_DONTWAIT | MSG_NOSIGNAL);
+        if(sent >= 0) {
+            client.forwarded++;
+        }
+        else if(errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+            client.dropped++;
+        }
+        else {
+            // ECONNREFUSED, ENOENT : client socket was closed.
+            client.disconnected = true;
+        }
+    }
+}
+
+void PingProxy::receive_loop()
+{
+    while(proxyRunning_) {
+        for(unsigned int n = 0; n < proxyConfig_.batchSize; n++) {
+            headers_[n].msg_hdr.msg_name    = &addresses_[n];
+            headers_[n].msg_hdr.msg_namelen = sizeof(sockaddr_un);
+        }
+        int count = recvmmsg(socket_, headers_.data(), proxyConfig_.batchSize,
+                             MSG_WAITFORONE, nullptr);
+        if(count < 0) {
+            if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "PingProxy::receive_loop : got socket error ("
+                          << std::strerror(errno) << ')' << std::endl;
+                proxyRunning_ = false;
+                break;
+            }
+            count = 0;
+        }
+        for(int n = 0; n < count; n++) {
+            if(headers_[n].msg_hdr.msg_flags & MSG_TRUNC) {
+                continue;
+            }
+            this->process_datagram(addresses_[n], headers_[n].msg_hdr.msg_namelen,
+                                   buffers_.data() + n*proxyConfig_.datagramSize,
+                                   headers_[n].msg_len);
+        }
+        this->remove_disconnected();
+    }
+}
+
+void PingProxy::process_datagram(const sockaddr_un& address, socklen_t addressLength,
+                                 const uint8_t* data, std::size_t size)
+{
+    if(ProxyControl::is_control(data, size)) {
+        ProxyControl control;
+        std::memcpy(&control, data, sizeof(control));
+        this->process_control(address, addressLength, control);
+        return;
+    }
+
+    int client = this->find_client(address, addressLength);
+    if(client < 0) {
+        client = this->add_client(address, addressLength);
+        if(client < 0) {
+            return;
+        }
+    }
+    for_each_frame(data, size, [&](const uint8_t* frame, std::size_t frameSize) {
+        this->process_command(client, frame, frameSize);
+    });
+}
+
+void PingProxy::process_control(const sockaddr_un& address, socklen_t addressLength,
+                                const ProxyControl& control)
+{
+    int client = this->find_client(address, addressLength);
+    switch(control.request) {
+        case ProxyControl::Subscribe:
+            if(client < 0) {
+                client = this->add_client(address, addressLength);
+            }
+            if(client >= 0) {
+                {
+                    std::lock_guard<std::mutex> lock(clientsMutex_);
+                    clients_[client].priority = control.priority;
+                }
+                // Sent from the client socket, the client connects to it.
+                ProxyControl ack(ProxyControl::Subscribe, control.priority);
+                ::send(clients_[client].socket, &ack, sizeof(ack), MSG_DONTWAIT | MSG_NOSIGNAL);
+            }
+            break;
+        case ProxyControl::Unsubscribe:
+            if(client >= 0) {
+                std::lock_guard<std::mutex> lock(clientsMutex_);
+                this->remove_client(client);
+            }
+            break;
+        case ProxyControl::ReleaseLease:
+            if(client >= 0 && client == leaseHolder_) {
+                std::lock_guard<std::mutex> lock(clientsMutex_);
+                leaseHolder_ = -1;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void PingProxy::process_command(int client, const uint8_t* frame, std::size_t size)
+{
+    auto header = reinterpret_cast<const MessageHeader*>(frame);
+    if(header->message_id == GeneralRequest::MessageId) {
+        uint16_t requestedId;
+        std::memcpy(&requestedId, frame + sizeof(MessageHeader), sizeof(requestedId));
+        if(requestedId == ProtocolVersion::MessageId) {
+            // Handshake of the client, the device must not answer to
+            // everyone.
+            if(this->state() == Connected) {
+                this->reply(client, this->protocol_version());
+            }
+            return;
+        }
+    }
+    else if(!this->acquire_lease(client)) {
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex_);
+            clients_[client].rejected++;
+        }
+        this->reply(client, NotAcknowledged(header->message_id,
+                                            "device leased by another client"));
+        return;
+    }
+
+    command_.accomodate_for_message(*header);
+    std::memcpy(command_.data(), frame, size);
+    try {
+        this->send(command_);
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        clients_[client].commands++;
+    }
+    catch(const std::exception& e) {
+        this->reply(client, NotAcknowledged(header->message_id, e.what()));
+    }
+}
+
+bool PingProxy::acquire_lease(int client)
+{
+    std::lock_guard<std::mutex> lock(clientsMutex_);
+    auto now = Clock::now();
+    if(leaseHolder_ >= 0 && leaseHolder_ != client && now < leaseExpiry_
+       && clients_[leaseHolder_].priority >= clients_[client].priority)
+    {
+        return false;
+    }
+    leaseHolder_ = client;
+    leaseExpiry_ = now + proxyConfig_.leaseDuration;
+    return true;
+}
+
+int PingProxy::find_client(const sockaddr_un& address, socklen_t addressLength) const
+{
+    std::lock_guard<std::mutex> lock(clientsMutex_);
+    for(unsigned int n = 0; n < clients_.size(); n++) {
+        if(clients_[n].addressLength == addressLength
+           && std::memcmp(&clients_[n].address, &address, addressLength) == 0)
+        {
+            return n;
+        }
+    }
+    return -1;
+}
+
+int PingProxy::add_client(const sockaddr_un& address, socklen_t addressLength)
+{
+    std::lock_guard<std::mutex> lock(clientsMutex_);
+    std::size_t pathLength = addressLength - offsetof(sockaddr_un, sun_path);
+    if(pathLength == 0 || clients_.size() >= proxyConfig_.maxClients) {
+        // unbound sockets cannot receive anything
+        return -1;
+    }
+
+    // Dedicated socket, frames queued for this client are charged to its
+    // send buffer only.
+    sa_family_t family = AF_UNIX;
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if(fd < 0
+       || bind(fd, reinterpret_cast<const sockaddr*>(&family), sizeof(family)) != 0
+       || setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &proxyConfig_.clientBufferSize,
+                     sizeof(proxyConfig_.clientBufferSize)) != 0
+       || connect(fd, reinterpret_cast<const sockaddr*>(&address), addressLength) != 0)
+    {
+        std::cerr << "PingProxy : could not create client socket ("
+                  << std::strerror(errno) << ')' << std::endl;
+        if(fd >= 0) close(fd);
+        return -1;
+    }
+
+    Client client;
+    client.socket = fd;
+    std::memset(&client.address, 0, sizeof(client.address));
+    std::memcpy(&client.address, &address, addressLength);
+    client.addressLength = addressLength;
+    if(address.sun_path[0] == '\0') {
+        // abstract socket (autobind)
+        client.name = '@' + std::string(address.sun_path + 1, pathLength - 1);
+    }
+    else {
+        client.name = std::string(address.sun_path, strnlen(address.sun_path, pathLength));
+    }
+    client.priority     = 0;
+    client.forwarded    = 0;
+    client.dropped      = 0;
+    client.commands     = 0;
+    client.rejected     = 0;
+    client.disconnected = false;
+    clients_.push_back(client);
+    return clients_.size() - 1;
+}
+
+void PingProxy::remove_client(int client)
+{
+    // clientsMutex_ must be locked.
+    close(clients_[client].socket);
+    clients_.erase(clients_.begin() + client);
+    if(leaseHolder_ == client) {
+        leaseHolder_ = -1;
+    }
+    else if(leaseHolder_ > client) {
+        leaseHolder_--;
+    }
+}
+
+void PingProxy::remove_disconnected()
+{
+    std::lock_guard<std::mutex> lock(clientsMutex_);
+    for(int n = clients_.size() - 1; n >= 0; n--) {
+        if(clients_[n].disconnected) {
+            this->remove_client(n);
+        }
+    }
+}
+
+void PingProxy::reply(int client, const Message& msg)
+{
+    // Only the receive thread adds or removes clients.
+    if(::send(clients_[client].socket, msg.data(), msg.size(),
+              MSG_DONTWAIT | MSG_NOSIGNAL) < 0
+       && errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS)
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        clients_[client].disconnected = true;
+    }
+}
+
+} //namespace ping_protocol
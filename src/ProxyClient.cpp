@@ -0,0 +1,261 @@
+#include <ping_protocol/ProxyClient.h>
+#include <ping_protocol/messages/frame_utils.h>
+#include <ping_protocol/messages/format_utils.h>
+
+#include <iostream>
+#include <sstream>
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace ping_protocol {
+
+ProxyClient::ProxyClient(const std::string& socketPath, int priority,
+                         unsigned int datagramSize) :
+    socket_(-1),
+    priority_(priority),
+    running_(false),
+    connected_(false),
+    keepAlivePending_(false),
+    incomingMessage_(0, datagramSize),
+    retryConfig_(default_retry_config()),
+    backoff_(retryConfig_.backoffMin)
+{
+    std::memset(&proxyAddress_, 0, sizeof(proxyAddress_));
+    proxyAddress_.sun_family = AF_UNIX;
+    if(socketPath.size() >= sizeof(proxyAddress_.sun_path)) {
+        std::ostringstream oss;
+        oss << "ProxyClient : socket path too long '" << socketPath << "'";
+        throw std::runtime_error(oss.str());
+    }
+    std::strcpy(proxyAddress_.sun_path, socketPath.c_str());
+
+    socket_ = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if(socket_ < 0) {
+        std::ostringstream oss;
+        oss << "ProxyClient : could not create socket (" << std::strerror(errno) << ')';
+        throw std::runtime_error(oss.str());
+    }
+    timeval timeout = {0, 100000};
+    setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // Binding with only the address family gives a unique abstract address
+    // (autobind), the proxy needs an address to reply to.
+    sa_family_t family = AF_UNIX;
+    if(bind(socket_, reinterpret_cast<const sockaddr*>(&family), sizeof(family)) != 0) {
+        int err = errno;
+        close(socket_);
+        std::ostringstream oss;
+        oss << "ProxyClient : could not bind socket (" << std::strerror(err) << ')';
+        throw std::runtime_error(oss.str());
+    }
+}
+
+ProxyClient::~ProxyClient()
+{
+    this->stop();
+    // best effort, the proxy also detects closed sockets.
+    ProxyControl control(ProxyControl::Unsubscribe);
+    sendto(socket_, &control, sizeof(control), MSG_DONTWAIT | MSG_NOSIGNAL,
+           reinterpret_cast<const sockaddr*>(&proxyAddress_), sizeof(proxyAddress_));
+    close(socket_);
+}
+
+ProxyClient::Ptr ProxyClient::Create(const std::string& socketPath, int priority,
+                                     unsigned int datagramSize)
+{
+    auto client = Ptr(new ProxyClient(socketPath, priority, datagramSize));
+    client->initiate_connection();
+    return client;
+}
+
+void ProxyClient::send_datagram(const void* data, std::size_t size)
+{
+    // Always addressed to the proxy socket, the client socket is connected to
+    // the dedicated one.
+    auto sent = sendto(socket_, data, size, MSG_NOSIGNAL,
+                       reinterpret_cast<const sockaddr*>(&proxyAddress_),
+                       sizeof(proxyAddress_));
+    if(sent < 0 || (std::size_t)sent != size) {
+        std::ostringstream oss;
+        oss << "ProxyClient : could not send to '" << proxyAddress_.sun_path
+            << "' (" << (sent < 0 ? std::strerror(errno) : "truncated") << ')';
+        throw std::runtime_error(oss.str());
+    }
+}
+
+void ProxyClient::send_control(ProxyControl::Request request)
+{
+    ProxyControl control(request, priority_);
+    this->send_datagram(&control, sizeof(control));
+}
+
+void ProxyClient::send(const Message& msg)
+{
+    this->send_datagram(msg.data(), msg.size());
+}
+
+void ProxyClient::release_lease()
+{
+    this->send_control(ProxyControl::ReleaseLease);
+}
+
+ProtocolVersion ProxyClient::protocol_version() const
+{
+    std::lock_guard<std::mutex> lock(versionMutex_);
+    return protocolVersion_;
+}
+
+void ProxyClient::set_retry_config(const RetryConfig& config)
+{
+    std::lock_guard<std::mutex> lock(retryMutex_);
+    retryConfig_ = config;
+    backoff_     = retryConfig_.backoffMin;
+}
+
+void ProxyClient::subscribe()
+{
+    // A restarted proxy answers from a new dedicated socket, the client
+    // socket must not stay connected to the previous one.
+    sockaddr unspecified;
+    std::memset(&unspecified, 0, sizeof(unspecified));
+    unspecified.sa_family = AF_UNSPEC;
+    connect(socket_, &unspecified, sizeof(unspecified));
+
+    this->send_control(ProxyControl::Subscribe);
+    this->send(GeneralRequest(ProtocolVersion::MessageId));
+}
+
+void ProxyClient::initiate_connection()
+{
+    {
+        std::lock_guard<std::mutex> lock(retryMutex_);
+        connected_   = false;
+        backoff_     = retryConfig_.backoffMin;
+        nextAttempt_ = Clock::now() + backoff_;
+    }
+    if(!running_) {
+        running_ = true;
+        thread_ = std::thread(&ProxyClient::receive_loop, this);
+    }
+    try {
+        this->subscribe();
+    }
+    catch(const std::exception& e) {
+        // proxy not started yet, retried by the receive thread.
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void ProxyClient::supervise(Clock::time_point now)
+{
+    bool attempt   = false;
+    bool keepAlive = false;
+    {
+        std::lock_guard<std::mutex> lock(retryMutex_);
+        auto halfTimeout = retryConfig_.linkTimeout / 2;
+        if(connected_) {
+            if(now - lastActivity_ >= retryConfig_.linkTimeout) {
+                std::cerr << "ProxyClient : link lost (no answer from the proxy)" << std::endl;
+                connected_        = false;
+                keepAlivePending_ = false;
+                backoff_          = retryConfig_.backoffMin;
+                nextAttempt_      = now;
+            }
+            else if(now - lastActivity_ >= halfTimeout && now - lastKeepAlive_ >= halfTimeout) {
+                // The device is idle, checking the proxy is still there.
+                lastKeepAlive_    = now;
+                keepAlivePending_ = true;
+                keepAlive         = true;
+            }
+        }
+        if(!connected_ && now >= nextAttempt_) {
+            attempt      = true;
+            nextAttempt_ = now + backoff_;
+            backoff_     = std::min(2*backoff_, retryConfig_.backoffMax);
+        }
+    }
+    try {
+        if(attempt) {
+            this->subscribe();
+        }
+        else if(keepAlive) {
+            this->send(GeneralRequest(ProtocolVersion::MessageId));
+        }
+    }
+    catch(const std::exception&) {
+        // proxy socket not there (yet), retried after the backoff.
+    }
+}
+
+void ProxyClient::stop()
+{
+    running_ = false;
+    if(thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void ProxyClient::receive_loop()
+{
+    // recvfrom times out periodically, the retries are driven from here.
+    while(running_) {
+        this->supervise(Clock::now());
+
+        sockaddr_un source;
+        socklen_t   sourceLength = sizeof(source);
+        auto size = recvfrom(socket_, incomingMessage_.data(),
+                             incomingMessage_.bytes().size(), 0,
+                             reinterpret_cast<sockaddr*>(&source), &sourceLength);
+        if(size < 0) {
+            if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                continue;
+            }
+            std::cerr << "ProxyClient::receive_loop : got socket error ("
+                      << std::strerror(errno) << ')' << std::endl;
+            running_ = false;
+            break;
+        }
+        if(ProxyControl::is_control(incomingMessage_.data(), size)) {
+            // Subscription acknowledged from the socket dedicated to this
+            // client. Connecting to it lets the proxy queue frames up to its
+            // own buffer size instead of the default datagram queue length.
+            connect(socket_, reinterpret_cast<const sockaddr*>(&source), sourceLength);
+            continue;
+        }
+        if(frame_size(incomingMessage_.data(), size) == 0) {
+            continue;
+        }
+        lastActivity_ = Clock::now();
+        if(incomingMessage_.header().message_id == ProtocolVersion::MessageId
+           && (std::size_t)size == ProtocolVersion::FixedSize
+           && (!connected_ || keepAlivePending_))
+        {
+            // Answer to a handshake or keep-alive request, not forwarded.
+            {
+                std::lock_guard<std::mutex> lock(versionMutex_);
+                std::memcpy(protocolVersion_.data(), incomingMessage_.data(), size);
+            }
+            keepAlivePending_ = false;
+            if(!connected_) {
+                std::lock_guard<std::mutex> lock(retryMutex_);
+                connected_ = true;
+                backoff_   = retryConfig_.backoffMin;
+            }
+            continue;
+        }
+        // Device frames are forwarded even before the handshake is answered.
+        this->message_callback(incomingMessage_);
+    }
+}
+
+void ProxyClient::message_callback(const Message& msg) const
+{
+    // Compact single line, formatted without allocation.
+    char line[512];
+    std::cout.write(line, format_message(line, sizeof(line), msg));
+}
+
+} //namespace ping_protocol
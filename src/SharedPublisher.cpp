@@ -0,0 +1,156 @@
+#include <ping_protocol/SharedPublisher.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ping_protocol {
+
+SharedPublisher::SharedPublisher(const std::string& name,
+                                 uint32_t slotCount,
+                                 uint32_t slotSize) :
+    name_(name),
+    mappedSize_(0),
+    header_(nullptr),
+    slots_(nullptr)
+{
+    // slots must keep the alignment of SharedSlotHeader
+    slotSize = (slotSize + alignof(SharedSlotHeader) - 1)
+             & ~(uint32_t)(alignof(SharedSlotHeader) - 1);
+    if(slotCount == 0 || slotSize <= sizeof(SharedSlotHeader)) {
+        std::ostringstream oss;
+        oss << "SharedPublisher : invalid ring dimensions ("
+            << slotCount << " slots of " << slotSize << " bytes)";
+        throw std::runtime_error(oss.str());
+    }
+
+    // O_EXCL : the ring is reset below, which must never happen to the ring
+    // of a running publisher.
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0) {
+        int err = errno;
+        std::ostringstream oss;
+        oss << "SharedPublisher : could not create shared memory '" << name_
+            << "' (" << std::strerror(err) << ')';
+        if(err == EEXIST) {
+            oss << ". Another publisher is using it, or it was left by a "
+                << "publisher which did not exit cleanly (remove /dev/shm"
+                << name_ << " in that case)";
+        }
+        throw std::runtime_error(oss.str());
+    }
+
+    mappedSize_ = shared_ring_size(slotCount, slotSize);
+    if(ftruncate(fd, mappedSize_) != 0) {
+        int err = errno;
+        close(fd);
+        shm_unlink(name_.c_str());
+        std::ostringstream oss;
+        oss << "SharedPublisher : could not resize shared memory '" << name_
+            << "' (" << std::strerror(err) << ')';
+        throw std::runtime_error(oss.str());
+    }
+
+    void* ptr = mmap(nullptr, mappedSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(ptr == MAP_FAILED) {
+        int err = errno;
+        shm_unlink(name_.c_str());
+        std::ostringstream oss;
+        oss << "SharedPublisher : could not map shared memory '" << name_
+            << "' (" << std::strerror(err) << ')';
+        throw std::runtime_error(oss.str());
+    }
+
+    // Readers check magic last, so it is written after everything else.
+    std::memset(ptr, 0, mappedSize_);
+    header_ = new(ptr) SharedRingHeader;
+    header_->version    = SharedRingHeader::Version;
+    header_->slot_count = slotCount;
+    header_->slot_size  = slotSize;
+    header_->head.store(0, std::memory_order_relaxed);
+
+    slots_ = reinterpret_cast<uint8_t*>(ptr) + sizeof(SharedRingHeader);
+    for(uint32_t n = 0; n < slotCount; n++) {
+        new(slots_ + ((std::size_t)n)*slotSize) SharedSlotHeader;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = SharedRingHeader::Magic;
+}
+
+SharedPublisher::~SharedPublisher()
+{
+    if(header_) {
+        munmap(header_, mappedSize_);
+        shm_unlink(name_.c_str());
+    }
+}
+
+SharedPublisher::Ptr SharedPublisher::Create(const std::string& name,
+                                             uint32_t slotCount,
+                                             uint32_t slotSize)
+{
+    return Ptr(new SharedPublisher(name, slotCount, slotSize));
+}
+
+SharedSlotHeader* SharedPublisher::begin_record(uint32_t kind,
+                                                std::size_t size,
+                                                uint64_t& index)
+{
+    if(size > this->max_record_size()) {
+        std::ostringstream oss;
+        oss << "SharedPublisher : record too large for ring slots ("
+            << size << '/' << this->max_record_size() << " bytes)";
+        throw std::runtime_error(oss.str());
+    }
+
+    index = header_->head.load(std::memory_order_relaxed);
+    auto slot = reinterpret_cast<SharedSlotHeader*>(
+        slots_ + (index % header_->slot_count)*header_->slot_size);
+
+    slot->sequence.store(2*index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->kind = kind;
+    slot->size = size;
+    return slot;
+}
+
+void SharedPublisher::end_record(SharedSlotHeader* slot, uint64_t index)
+{
+    slot->sequence.store(2*(index + 1), std::memory_order_release);
+    header_->head.store(index + 1, std::memory_order_release);
+}
+
+void SharedPublisher::publish(const Message& msg)
+{
+    uint64_t index;
+    auto slot = this->begin_record(RecordMessage, msg.size(), index);
+    std::memcpy(reinterpret_cast<uint8_t*>(slot + 1), msg.data(), msg.size());
+    this->end_record(slot, index);
+}
+
+void SharedPublisher::publish(const ping360::Sweep& sweep)
+{
+    uint64_t index;
+    auto slot = this->begin_record(RecordSweep,
+                                   sizeof(SharedSweepHeader) + sweep.size(),
+                                   index);
+
+    auto header = reinterpret_cast<SharedSweepHeader*>(slot + 1);
+    header->parameters   = sweep.parameters();
+    header->sample_count = sweep.sample_count();
+    header->row_count    = sweep.row_count();
+    std::memcpy(header->filled, sweep.filled(), ping360::Sweep::AngleCount);
+    std::memcpy(header + 1, sweep.data(), sweep.size());
+
+    this->end_record(slot, index);
+}
+
+} //namespace ping_protocol
@@ -0,0 +1,123 @@
+#include <ping_protocol/SharedReader.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ping_protocol {
+
+SharedReader::SharedReader(const std::string& name) :
+    name_(name),
+    mappedSize_(0),
+    header_(nullptr),
+    slots_(nullptr),
+    cursor_(0),
+    droppedCount_(0)
+{
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if(fd < 0) {
+        std::ostringstream oss;
+        oss << "SharedReader : could not open shared memory '" << name_
+            << "' (" << std::strerror(errno) << ')';
+        throw std::runtime_error(oss.str());
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (std::size_t)st.st_size < sizeof(SharedRingHeader)) {
+        close(fd);
+        std::ostringstream oss;
+        oss << "SharedReader : shared memory '" << name_ << "' is not a ring";
+        throw std::runtime_error(oss.str());
+    }
+
+    mappedSize_ = st.st_size;
+    void* ptr = mmap(nullptr, mappedSize_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(ptr == MAP_FAILED) {
+        std::ostringstream oss;
+        oss << "SharedReader : could not map shared memory '" << name_
+            << "' (" << std::strerror(errno) << ')';
+        throw std::runtime_error(oss.str());
+    }
+    header_ = reinterpret_cast<const SharedRingHeader*>(ptr);
+    slots_  = reinterpret_cast<const uint8_t*>(ptr) + sizeof(SharedRingHeader);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(header_->magic   != SharedRingHeader::Magic ||
+       header_->version != SharedRingHeader::Version ||
+       shared_ring_size(header_->slot_count, header_->slot_size) > mappedSize_)
+    {
+        munmap(ptr, mappedSize_);
+        header_ = nullptr;
+        std::ostringstream oss;
+        oss << "SharedReader : shared memory '" << name_
+            << "' is not a valid ring (or is not initialized yet)";
+        throw std::runtime_error(oss.str());
+    }
+
+    // Starting from the oldest record still available.
+    uint64_t head = this->head();
+    cursor_ = head > header_->slot_count ? head - header_->slot_count : 0;
+}
+
+SharedReader::~SharedReader()
+{
+    if(header_) {
+        munmap(const_cast<SharedRingHeader*>(header_), mappedSize_);
+    }
+}
+
+SharedReader::Ptr SharedReader::Create(const std::string& name)
+{
+    return Ptr(new SharedReader(name));
+}
+
+bool SharedReader::read(uint64_t index, SharedRecordView& view) const
+{
+    auto slot = reinterpret_cast<const SharedSlotHeader*>(
+        slots_ + (index % header_->slot_count)*header_->slot_size);
+
+    if(slot->sequence.load(std::memory_order_acquire) != 2*(index + 1)) {
+        // not written yet, being written or already overwritten
+        return false;
+    }
+    view.slot  = slot;
+    view.index = index;
+    view.kind  = slot->kind;
+    view.size  = slot->size;
+    view.data  = reinterpret_cast<const uint8_t*>(slot + 1);
+
+    // kind and size are checked before being used by the caller
+    return view.is_valid()
+        && view.size <= header_->slot_size - sizeof(SharedSlotHeader);
+}
+
+bool SharedReader::next(SharedRecordView& view)
+{
+    for(uint64_t head = this->head(); cursor_ < head; head = this->head()) {
+        if(head - cursor_ > header_->slot_count) {
+            // lapped by the publisher
+            droppedCount_ += head - header_->slot_count - cursor_;
+            cursor_ = head - header_->slot_count;
+        }
+        if(this->read(cursor_++, view)) {
+            return true;
+        }
+        droppedCount_++;
+    }
+    return false;
+}
+
+bool SharedReader::latest(SharedRecordView& view) const
+{
+    uint64_t head = this->head();
+    return head > 0 && this->read(head - 1, view);
+}
+
+} //namespace ping_protocol
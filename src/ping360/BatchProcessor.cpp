@@ -0,0 +1,452 @@
+#include <ping_protocol/ping360/BatchProcessor.h>
+
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ping_protocol/messages/frame_utils.h>
+#include <ping_protocol/ping360/WedgeRenderer.h>
+
+namespace ping_protocol { namespace ping360 {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(const Clock::time_point& t0)
+{
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+/**
+ * Runs taskCount tasks on threadCount threads. Tasks are dealt round-robin
+ * to per thread queues and a thread with an empty queue steals from the
+ * others.
+ *
+ * Both the owner and the thieves take the oldest task of a queue : tasks are
+ * coarse enough for the queue locks not to matter, and handling tasks in
+ * about their index order lets ordered results be released early.
+ */
+class WorkStealingPool
+{
+    protected:
+
+    struct Queue {
+        std::mutex               mutex;
+        std::deque<unsigned int> tasks;
+    };
+
+    unsigned int             threadCount_;
+    std::unique_ptr<Queue[]> queues_;
+    std::atomic<uint64_t>    stealCount_;
+    std::atomic<bool>        aborted_;
+
+    bool pop(unsigned int worker, unsigned int& task)
+    {
+        for(unsigned int n = 0; n < threadCount_ && !aborted_; n++) {
+            Queue& queue = queues_[(worker + n) % threadCount_];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if(!queue.tasks.empty()) {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+                if(n > 0) {
+                    stealCount_++;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    public:
+
+    WorkStealingPool(unsigned int threadCount) :
+        threadCount_(std::max(1u, threadCount)),
+        queues_(new Queue[threadCount_]),
+        stealCount_(0),
+        aborted_(false)
+    {}
+
+    unsigned int thread_count() const { return threadCount_; }
+    uint64_t steal_count() const { return stealCount_; }
+
+    // Calls f(task, worker) for each task. The first exception thrown by f
+    // stops the remaining tasks and is rethrown once all threads are joined.
+    template <class F>
+    void run(unsigned int taskCount, F&& f)
+    {
+        for(unsigned int task = 0; task < taskCount; task++) {
+            queues_[task % threadCount_].tasks.push_back(task);
+        }
+        aborted_ = false;
+
+        std::mutex         errorMutex;
+        std::exception_ptr error;
+        auto work = [&](unsigned int worker) {
+            try {
+                unsigned int task;
+                while(this->pop(worker, task)) {
+                    f(task, worker);
+                }
+            }
+            catch(...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if(!error) {
+                    error = std::current_exception();
+                }
+                aborted_ = true;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for(unsigned int worker = 1; worker < threadCount_; worker++) {
+            threads.emplace_back(work, worker);
+        }
+        work(0);
+        for(auto& thread : threads) {
+            thread.join();
+        }
+
+        for(unsigned int n = 0; n < threadCount_; n++) {
+            queues_[n].tasks.clear();
+        }
+        if(error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+bool read_row(const uint8_t* frame, uint64_t offset, BatchProcessor::Row& row)
+{
+    MessageHeader header;
+    std::memcpy(&header, frame, sizeof(header));
+    if(header.message_id != DeviceData::MessageId
+       || header.payload_length < sizeof(DeviceData::Metadata))
+    {
+        return false;
+    }
+    DeviceData::Metadata meta;
+    std::memcpy(&meta, frame + sizeof(MessageHeader), sizeof(meta));
+
+    row.offset      = offset;
+    row.parameters  = meta;
+    row.sampleCount = std::min<std::size_t>(meta.data_length,
+        header.payload_length - sizeof(DeviceData::Metadata));
+    return true;
+}
+
+// Frames starting in a byte range of the recording.
+struct Segment {
+    uint64_t                                   begin;
+    uint64_t                                   end;
+    uint64_t                                   parsedEnd; // end of the last frame, >= end
+    std::vector<std::pair<uint64_t, uint64_t>> frames;    // [begin, end) of each frame
+    std::vector<BatchProcessor::Row>           rows;
+};
+
+struct MappedFile {
+    void*       data;
+    std::size_t size;
+
+    MappedFile() : data(nullptr), size(0) {}
+    ~MappedFile() {
+        if(data) {
+            munmap(data, size);
+        }
+    }
+};
+
+} //namespace
+
+BatchProcessor::BatchProcessor(const Config& config) :
+    config_(config)
+{
+    if(config_.sweepsPerChunk == 0 || config_.maxPendingChunks == 0
+       || config_.angleStep == 0)
+    {
+        std::ostringstream oss;
+        oss << "BatchProcessor : invalid configuration (sweepsPerChunk "
+            << config_.sweepsPerChunk << ", maxPendingChunks "
+            << config_.maxPendingChunks << ", angleStep " << config_.angleStep << ')';
+        throw std::runtime_error(oss.str());
+    }
+    if(config_.threadCount == 0) {
+        config_.threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::memset(&stats_, 0, sizeof(stats_));
+}
+
+BatchProcessor::Ptr BatchProcessor::Create(const Config& config)
+{
+    return Ptr(new BatchProcessor(config));
+}
+
+void BatchProcessor::index_frames(const uint8_t* data, std::size_t size)
+{
+    constexpr std::size_t MinSegmentSize = 64*1024;
+
+    WorkStealingPool pool(config_.threadCount);
+    std::size_t segmentCount = std::min<std::size_t>(8*pool.thread_count(),
+        std::max<std::size_t>(1, size / MinSegmentSize));
+
+    std::vector<Segment> segments(segmentCount);
+    pool.run(segmentCount, [&](unsigned int n, unsigned int) {
+        Segment& segment = segments[n];
+        segment.begin = size * n / segmentCount;
+        segment.end   = size * (n + 1) / segmentCount;
+
+        uint64_t pos = segment.begin;
+        while(pos < segment.end) {
+            std::size_t frameSize = frame_size(data + pos, size - pos);
+            if(frameSize == 0) {
+                pos++;
+                continue;
+            }
+            segment.frames.push_back(std::make_pair(pos, pos + frameSize));
+            Row row;
+            if(read_row(data + pos, pos, row)) {
+                segment.rows.push_back(row);
+            }
+            pos += frameSize;
+        }
+        segment.parsedEnd = pos;
+    });
+    stats_.stealCount += pool.steal_count();
+
+    // A segment which started inside the last frame of the previous one may
+    // have synchronized on a false frame start. The serial parse is resumed
+    // from the end of the previous segment until it reaches a position the
+    // segment parse also went through (one which is not inside one of its
+    // frames), from where both parses are identical.
+    uint64_t frameBytes = 0;
+    uint64_t pos = 0;
+    rows_.clear();
+    for(const auto& segment : segments) {
+        auto frame = segment.frames.begin();
+        while(true) {
+            while(frame != segment.frames.end() && frame->second <= pos) {
+                frame++;
+            }
+            if(frame == segment.frames.end() || frame->first >= pos) {
+                break;
+            }
+            std::size_t frameSize = frame_size(data + pos, size - pos);
+            if(frameSize == 0) {
+                pos++;
+                continue;
+            }
+            Row row;
+            if(read_row(data + pos, pos, row)) {
+                rows_.push_back(row);
+            }
+            stats_.frameCount++;
+            frameBytes += frameSize;
+            pos += frameSize;
+        }
+        for(; frame != segment.frames.end(); frame++) {
+            stats_.frameCount++;
+            frameBytes += frame->second - frame->first;
+        }
+        auto row = std::lower_bound(segment.rows.begin(), segment.rows.end(), pos,
+            [](const Row& row, uint64_t offset) { return row.offset < offset; });
+        rows_.insert(rows_.end(), row, segment.rows.end());
+
+        pos = std::max(pos, segment.parsedEnd);
+    }
+    stats_.rowCount     = rows_.size();
+    stats_.skippedBytes = size - frameBytes;
+}
+
+void BatchProcessor::split_sweeps()
+{
+    // Same rule as SweepAssembler::add_row
+    sweepStarts_.clear();
+    std::vector<uint8_t> filled(Sweep::AngleCount, 0);
+    uint16_t sampleCount  = 0;
+    uint16_t samplePeriod = 0;
+    for(std::size_t n = 0; n < rows_.size(); n++) {
+        const PingParameters& params = rows_[n].parameters;
+        unsigned int angle = params.angle % Sweep::AngleCount;
+        if(n == 0 || params.number_of_samples != sampleCount
+           || params.sample_period != samplePeriod || filled[angle])
+        {
+            sweepStarts_.push_back(n);
+            std::fill(filled.begin(), filled.end(), 0);
+            sampleCount = params.number_of_samples;
+        }
+        filled[angle] = 1;
+        samplePeriod  = params.sample_period;
+    }
+    sweepStarts_.push_back(rows_.size());
+    stats_.sweepCount = sweepStarts_.size() - 1;
+}
+
+void BatchProcessor::process_sweeps(const uint8_t* data)
+{
+    struct Chunk {
+        std::vector<Sweep>                sweeps;
+        std::vector<std::vector<uint8_t>> images;
+        bool                              done;
+
+        Chunk() : done(false) {}
+    };
+
+    unsigned int sweepCount = stats_.sweepCount;
+    unsigned int chunkCount = (sweepCount + config_.sweepsPerChunk - 1) / config_.sweepsPerChunk;
+    stats_.chunkCount = chunkCount;
+
+    WorkStealingPool pool(config_.threadCount);
+    std::vector<std::unique_ptr<WedgeRenderer>> renderers(pool.thread_count());
+    if(config_.imageWidth > 0) {
+        for(auto& renderer : renderers) {
+            renderer.reset(new WedgeRenderer(config_.imageWidth, config_.angleStep,
+                                             config_.soundSpeed));
+        }
+    }
+
+    // Results are released in chunk order. A chunk is not started before the
+    // chunks far enough behind it are released, which bounds the memory used
+    // by finished results waiting for a slower chunk.
+    std::vector<Chunk>      chunks(chunkCount);
+    unsigned int            window = config_.maxPendingChunks*pool.thread_count();
+    unsigned int            nextChunk = 0;
+    bool                    failed = false;
+    std::mutex              mutex;
+    std::condition_variable released;
+
+    pool.run(chunkCount, [&](unsigned int c, unsigned int worker) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            released.wait(lock, [&]() { return failed || c < nextChunk + window; });
+            if(failed) {
+                return;
+            }
+        }
+        try {
+            Chunk& chunk = chunks[c];
+            unsigned int first = c*config_.sweepsPerChunk;
+            unsigned int last  = std::min(first + config_.sweepsPerChunk, sweepCount);
+            chunk.sweeps.resize(last - first);
+            chunk.images.resize(last - first);
+            for(unsigned int s = first; s < last; s++) {
+                Sweep& sweep = chunk.sweeps[s - first];
+                sweep.reset(rows_[sweepStarts_[s]].parameters.number_of_samples);
+                for(uint32_t r = sweepStarts_[s]; r < sweepStarts_[s + 1]; r++) {
+                    const Row& row = rows_[r];
+                    sweep.set_row(row.parameters, data + row.offset + sizeof(MessageHeader)
+                                                       + sizeof(DeviceData::Metadata),
+                                  row.sampleCount);
+                }
+                if(filter_) {
+                    filter_(sweep);
+                }
+                if(renderers[worker] && sweep.sample_count() > 0) {
+                    WedgeRenderer& renderer = *renderers[worker];
+                    renderer.render(sweep);
+                    chunk.images[s - first].assign(renderer.image(),
+                        renderer.image() + renderer.width()*renderer.width());
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            chunk.done = true;
+            for(; nextChunk < chunkCount && chunks[nextChunk].done; nextChunk++) {
+                Chunk& ready = chunks[nextChunk];
+                if(output_) {
+                    for(unsigned int n = 0; n < ready.sweeps.size(); n++) {
+                        unsigned int index = nextChunk*config_.sweepsPerChunk + n;
+                        Result result;
+                        result.index      = index;
+                        result.offset     = rows_[sweepStarts_[index]].offset;
+                        result.sweep      = &ready.sweeps[n];
+                        result.image      = ready.images[n].empty() ? nullptr
+                                                                    : ready.images[n].data();
+                        result.imageWidth = ready.images[n].empty() ? 0 : config_.imageWidth;
+                        output_(result);
+                    }
+                }
+                std::vector<Sweep>().swap(ready.sweeps);
+                std::vector<std::vector<uint8_t>>().swap(ready.images);
+            }
+            released.notify_all();
+        }
+        catch(...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            failed = true;
+            released.notify_all();
+            throw;
+        }
+    });
+    stats_.stealCount += pool.steal_count();
+}
+
+const BatchProcessor::Statistics& BatchProcessor::process(const uint8_t* data,
+                                                          std::size_t size)
+{
+    std::memset(&stats_, 0, sizeof(stats_));
+    stats_.bytes       = size;
+    stats_.threadCount = config_.threadCount;
+
+    auto t0 = Clock::now();
+    this->index_frames(data, size);
+    this->split_sweeps();
+    stats_.indexTime = seconds_since(t0);
+
+    auto t1 = Clock::now();
+    this->process_sweeps(data);
+    stats_.processTime = seconds_since(t1);
+    stats_.totalTime   = seconds_since(t0);
+
+    return stats_;
+}
+
+const BatchProcessor::Statistics& BatchProcessor::process_file(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        std::ostringstream oss;
+        oss << "BatchProcessor : could not open '" << path
+            << "' (" << std::strerror(errno) << ')';
+        throw std::runtime_error(oss.str());
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        std::ostringstream oss;
+        oss << "BatchProcessor : could not stat '" << path
+            << "' (" << std::strerror(errno) << ')';
+        throw std::runtime_error(oss.str());
+    }
+
+    MappedFile file;
+    file.size = st.st_size;
+    if(file.size > 0) {
+        void* ptr = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(ptr == MAP_FAILED) {
+            close(fd);
+            std::ostringstream oss;
+            oss << "BatchProcessor : could not map '" << path
+                << "' (" << std::strerror(errno) << ')';
+            throw std::runtime_error(oss.str());
+        }
+        file.data = ptr;
+        madvise(file.data, file.size, MADV_WILLNEED);
+    }
+    close(fd);
+
+    return this->process(reinterpret_cast<const uint8_t*>(file.data), file.size);
+}
+
+} //namespace ping360
+} //namespace ping_protocol
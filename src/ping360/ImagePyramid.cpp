@@ -0,0 +1,256 @@
+#include <ping_protocol/ping360/ImagePyramid.h>
+
+#include <sstream>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ping_protocol { namespace ping360 {
+
+namespace {
+
+// Reduces pixels [first, last) of a destination row from two source rows of
+// width pixels.
+template <ImagePyramid::Reduction R>
+void reduce_row(const uint8_t* row0, const uint8_t* row1, unsigned int width,
+                uint8_t* dst, unsigned int first, unsigned int last)
+{
+    unsigned int x = first;
+#ifdef __SSE2__
+    // 16 destination pixels from 32 source pixels per iteration.
+    const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+    for(; x + 16 <= last && 2*x + 32 <= width; x += 16) {
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2*x));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2*x + 16));
+        __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2*x));
+        __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2*x + 16));
+        __m128i v0, v1;
+        if(R == ImagePyramid::Max) {
+            // vertical then horizontal pairs, result in the low byte of each
+            // 16 bit lane
+            v0 = _mm_max_epu8(a0, b0);
+            v1 = _mm_max_epu8(a1, b1);
+            v0 = _mm_max_epu8(v0, _mm_srli_epi16(v0, 8));
+            v1 = _mm_max_epu8(v1, _mm_srli_epi16(v1, 8));
+        }
+        else {
+            v0 = _mm_avg_epu8(a0, b0);
+            v1 = _mm_avg_epu8(a1, b1);
+            v0 = _mm_avg_epu8(v0, _mm_srli_epi16(v0, 8));
+            v1 = _mm_avg_epu8(v1, _mm_srli_epi16(v1, 8));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x),
+                         _mm_packus_epi16(_mm_and_si128(v0, lowBytes),
+                                          _mm_and_si128(v1, lowBytes)));
+    }
+#endif
+    for(; x < last; x++) {
+        unsigned int x0 = 2*x, x1 = std::min(2*x + 1, width - 1);
+        if(R == ImagePyramid::Max) {
+            dst[x] = std::max(std::max(row0[x0], row0[x1]),
+                              std::max(row1[x0], row1[x1]));
+        }
+        else {
+            // same rounding as the pairwise averages above
+            unsigned int v0 = (row0[x0] + row1[x0] + 1) >> 1;
+            unsigned int v1 = (row0[x1] + row1[x1] + 1) >> 1;
+            dst[x] = (v0 + v1 + 1) >> 1;
+        }
+    }
+}
+
+} //namespace
+
+ImagePyramid::ImagePyramid(unsigned int width, unsigned int height,
+                           Reduction reduction, unsigned int tileSize,
+                           unsigned int levelCount) :
+    reduction_(reduction),
+    tileSize_(tileSize),
+    maxLevelCount_(levelCount)
+{
+    if(tileSize_ == 0) {
+        throw std::runtime_error("ImagePyramid : tile size must be > 0");
+    }
+    this->resize(width, height);
+}
+
+ImagePyramid::Ptr ImagePyramid::Create(unsigned int width, unsigned int height,
+                                       Reduction reduction, unsigned int tileSize,
+                                       unsigned int levelCount)
+{
+    return Ptr(new ImagePyramid(width, height, reduction, tileSize, levelCount));
+}
+
+void ImagePyramid::resize(unsigned int width, unsigned int height)
+{
+    // Versions keep increasing so displays notice the change.
+    uint64_t version = 0;
+    for(const auto& level : levels_) {
+        for(auto v : level.versions) version = std::max(version, v);
+    }
+    version++;
+
+    levels_.clear();
+    do {
+        Level level;
+        level.width   = width;
+        level.height  = height;
+        level.columns = (width  + tileSize_ - 1) / tileSize_;
+        level.rows    = (height + tileSize_ - 1) / tileSize_;
+        level.data.assign(width*height, 0);
+        level.versions.assign(level.columns*level.rows, version);
+        levels_.push_back(std::move(level));
+
+        width  = (width  + 1) / 2;
+        height = (height + 1) / 2;
+    }
+    while((maxLevelCount_ == 0 && (levels_.back().columns > 1 || levels_.back().rows > 1))
+          || levels_.size() < maxLevelCount_);
+}
+
+void ImagePyramid::clear()
+{
+    for(auto& level : levels_) {
+        std::fill(level.data.begin(), level.data.end(), 0);
+        for(auto& v : level.versions) v++;
+    }
+}
+
+ImagePyramid::Tile ImagePyramid::tile(unsigned int level, unsigned int column,
+                                      unsigned int row) const
+{
+    const Level& l = levels_.at(level);
+    if(column >= l.columns || row >= l.rows) {
+        std::ostringstream oss;
+        oss << "ImagePyramid : invalid tile (" << column << ',' << row
+            << ") at level " << level << " (" << l.columns << 'x' << l.rows << " tiles)";
+        throw std::runtime_error(oss.str());
+    }
+    Tile res;
+    res.level   = level;
+    res.column  = column;
+    res.row     = row;
+    res.data    = l.data.data() + row*tileSize_*l.width + column*tileSize_;
+    res.stride  = l.width;
+    res.width   = std::min(tileSize_, l.width  - column*tileSize_);
+    res.height  = std::min(tileSize_, l.height - row*tileSize_);
+    res.version = l.versions[row*l.columns + column];
+    return res;
+}
+
+void ImagePyramid::touch(Level& level, const Rectangle& dirty)
+{
+    for(unsigned int r = dirty.top / tileSize_; r <= (dirty.bottom - 1) / tileSize_; r++) {
+        for(unsigned int c = dirty.left / tileSize_; c <= (dirty.right - 1) / tileSize_; c++) {
+            level.versions[r*level.columns + c]++;
+        }
+    }
+}
+
+Rectangle ImagePyramid::reduce(unsigned int level, const Rectangle& dirty)
+{
+    const Level& src = levels_[level - 1];
+    Level&       dst = levels_[level];
+    Rectangle res({dirty.left / 2, dirty.top / 2,
+                   (dirty.right + 1) / 2, (dirty.bottom + 1) / 2});
+    for(unsigned int y = res.top; y < res.bottom; y++) {
+        const uint8_t* row0 = src.data.data() + 2*y*src.width;
+        const uint8_t* row1 = src.data.data() + std::min(2*y + 1, src.height - 1)*src.width;
+        uint8_t*       out  = dst.data.data() + y*dst.width;
+        if(reduction_ == Max) {
+            reduce_row<Max>(row0, row1, src.width, out, res.left, res.right);
+        }
+        else {
+            reduce_row<Mean>(row0, row1, src.width, out, res.left, res.right);
+        }
+    }
+    return res;
+}
+
+void ImagePyramid::update(const Rectangle& dirty)
+{
+    Rectangle rect({std::min(dirty.left,   levels_[0].width),
+                    std::min(dirty.top,    levels_[0].height),
+                    std::min(dirty.right,  levels_[0].width),
+                    std::min(dirty.bottom, levels_[0].height)});
+    if(rect.empty()) {
+        return;
+    }
+    this->touch(levels_[0], rect);
+    for(unsigned int level = 1; level < levels_.size(); level++) {
+        rect = this->reduce(level, rect);
+        this->touch(levels_[level], rect);
+    }
+}
+
+void ImagePyramid::update(const uint8_t* source, unsigned int sourceStride,
+                          const Rectangle& dirty)
+{
+    Level& level = levels_[0];
+    unsigned int right  = std::min(dirty.right,  level.width);
+    unsigned int bottom = std::min(dirty.bottom, level.height);
+    if(right <= dirty.left || bottom <= dirty.top) {
+        return;
+    }
+    for(unsigned int y = dirty.top; y < bottom; y++) {
+        std::memcpy(level.data.data() + y*level.width + dirty.left,
+                    source + y*sourceStride + dirty.left, right - dirty.left);
+    }
+    this->update(dirty);
+}
+
+SweepPyramid::SweepPyramid(unsigned int cartesianWidth,
+                           ImagePyramid::Reduction reduction,
+                           unsigned int tileSize, float soundSpeed) :
+    renderer_(cartesianWidth, 1, soundSpeed),
+    polar_(1, AngleCount, reduction, tileSize),
+    cartesian_(cartesianWidth, cartesianWidth, reduction, tileSize),
+    samplePeriod_(0)
+{}
+
+SweepPyramid::Ptr SweepPyramid::Create(unsigned int cartesianWidth,
+                                       ImagePyramid::Reduction reduction,
+                                       unsigned int tileSize, float soundSpeed)
+{
+    return Ptr(new SweepPyramid(cartesianWidth, reduction, tileSize, soundSpeed));
+}
+
+void SweepPyramid::clear()
+{
+    renderer_.clear();
+    polar_.clear();
+    cartesian_.clear();
+}
+
+void SweepPyramid::add_row(const DeviceData& row)
+{
+    const auto& params = row.ping_parameters();
+    if(params.number_of_samples == 0) {
+        return;
+    }
+    if(params.number_of_samples != polar_.width()) {
+        polar_.resize(params.number_of_samples, AngleCount);
+    }
+    else if(params.sample_period != samplePeriod_) {
+        polar_.clear();
+    }
+    samplePeriod_ = params.sample_period;
+
+    std::size_t available = row.payload_length() > sizeof(DeviceData::Metadata) ?
+        row.payload_length() - sizeof(DeviceData::Metadata) : 0;
+    std::size_t count = std::min<std::size_t>(row.metadata().data_length, available);
+    count = std::min<std::size_t>(count, polar_.width());
+
+    unsigned int angle = params.angle % AngleCount;
+    uint8_t* dst = polar_.level_data(0) + angle*polar_.width();
+    std::memcpy(dst, row.data(), count);
+    std::memset(dst + count, 0, polar_.width() - count);
+    polar_.update(Rectangle({0, angle, polar_.width(), angle + 1}));
+
+    cartesian_.update(renderer_.image(), renderer_.width(), renderer_.render(row));
+}
+
+} //namespace ping360
+} //namespace ping_protocol
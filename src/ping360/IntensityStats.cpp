@@ -0,0 +1,262 @@
+#include <ping_protocol/ping360/IntensityStats.h>
+
+#include <cmath>
+#include <sstream>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ping_protocol { namespace ping360 {
+
+namespace {
+
+// data_length is read from the wire : do not trust it further than the
+// payload actually received.
+std::size_t row_sample_count(const DeviceData& row)
+{
+    std::size_t available = row.payload_length() > sizeof(DeviceData::Metadata) ?
+        row.payload_length() - sizeof(DeviceData::Metadata) : 0;
+    return std::min<std::size_t>(row.metadata().data_length, available);
+}
+
+// sweep += row - stored, then stored = row (row counts fit in 16 bits).
+void replace_row(uint32_t* sweep, uint16_t* stored, const uint32_t* row)
+{
+    constexpr unsigned int BinCount = IntensityHistogram::BinCount;
+#ifdef __SSE2__
+    const __m128i zero   = _mm_setzero_si128();
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16((int16_t)0x8000);
+    for(unsigned int b = 0; b < BinCount; b += 8) {
+        __m128i old  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(stored + b));
+        __m128i new0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + b));
+        __m128i new1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + b + 4));
+        __m128i s0   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sweep + b));
+        __m128i s1   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sweep + b + 4));
+
+        s0 = _mm_add_epi32(_mm_sub_epi32(s0, _mm_unpacklo_epi16(old, zero)), new0);
+        s1 = _mm_add_epi32(_mm_sub_epi32(s1, _mm_unpackhi_epi16(old, zero)), new1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sweep + b),     s0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sweep + b + 4), s1);
+
+        // unsigned 32 to 16 bits narrowing (no packus_epi32 before SSE4.1)
+        __m128i packed = _mm_packs_epi32(_mm_sub_epi32(new0, bias32),
+                                         _mm_sub_epi32(new1, bias32));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(stored + b),
+                         _mm_xor_si128(packed, bias16));
+    }
+#else
+    for(unsigned int b = 0; b < BinCount; b++) {
+        sweep[b] += row[b] - stored[b];
+        stored[b] = row[b];
+    }
+#endif
+}
+
+} //namespace
+
+void IntensityHistogram::clear()
+{
+    std::memset(bins_, 0, sizeof(bins_));
+    count_ = 0;
+}
+
+void IntensityHistogram::add(const uint8_t* data, std::size_t size)
+{
+    // Plain scatter loop. SSE2 has no scatter instruction, and on ping sized
+    // rows neither compare-and-count kernels nor interleaved sub-histograms
+    // are faster than this (about 1ns per sample).
+    for(std::size_t i = 0; i < size; i++) {
+        bins_[data[i]]++;
+    }
+    count_ += size;
+}
+
+float IntensityHistogram::mean() const
+{
+    if(count_ == 0) {
+        return 0.0f;
+    }
+    uint64_t sum = 0;
+    for(unsigned int b = 0; b < BinCount; b++) {
+        sum += (uint64_t)b*bins_[b];
+    }
+    return (float)sum / count_;
+}
+
+uint8_t IntensityHistogram::max() const
+{
+    for(int b = BinCount - 1; b > 0; b--) {
+        if(bins_[b]) return b;
+    }
+    return 0;
+}
+
+uint8_t IntensityHistogram::percentile(float p) const
+{
+    uint64_t target = std::max<uint64_t>(1, std::ceil(p*count_));
+    uint64_t cumulated = 0;
+    for(unsigned int b = 0; b < BinCount; b++) {
+        cumulated += bins_[b];
+        if(cumulated >= target) return b;
+    }
+    return BinCount - 1;
+}
+
+float IntensityHistogram::fraction_above(uint8_t level) const
+{
+    if(count_ == 0) {
+        return 0.0f;
+    }
+    uint32_t count = 0;
+    for(unsigned int b = level; b < BinCount; b++) {
+        count += bins_[b];
+    }
+    return (float)count / count_;
+}
+
+SweepStatistics::SweepStatistics() :
+    rowBins_(AngleCount*BinCount, 0),
+    rowCounts_(AngleCount, 0)
+{}
+
+void SweepStatistics::reset()
+{
+    row_.clear();
+    sweep_.clear();
+    std::fill(rowBins_.begin(),   rowBins_.end(),   0);
+    std::fill(rowCounts_.begin(), rowCounts_.end(), 0);
+}
+
+const IntensityHistogram& SweepStatistics::add_row(const DeviceData& row)
+{
+    std::size_t count = std::min<std::size_t>(row_sample_count(row), UINT16_MAX);
+    row_.clear();
+    row_.add(row.data(), count);
+
+    unsigned int angle = row.ping_parameters().angle % AngleCount;
+    replace_row(sweep_.bins(), rowBins_.data() + angle*BinCount, row_.bins());
+    sweep_.set_count(sweep_.count() - rowCounts_[angle] + count);
+    rowCounts_[angle] = count;
+
+    return row_;
+}
+
+constexpr uint8_t      AutoGainController::MaxGainSetting;
+constexpr unsigned int AutoGainController::MaxPendingPings;
+
+AutoGainController::AutoGainController(const Config& config,
+                                       uint8_t gainSetting,
+                                       uint16_t transmitDuration) :
+    config_(config),
+    gainSetting_(std::min(gainSetting, MaxGainSetting)),
+    transmitDuration_(std::min(std::max(transmitDuration, config.minTransmitDuration),
+                               config.maxTransmitDuration)),
+    adjustmentCount_(0),
+    pendingPings_(0)
+{
+    if(config_.minTransmitDuration == 0
+       || config_.minTransmitDuration > config_.maxTransmitDuration
+       || config_.transmitStep <= 1.0f || config_.targetLow > config_.targetHigh)
+    {
+        std::ostringstream oss;
+        oss << "AutoGainController : invalid configuration (transmit duration ["
+            << config_.minTransmitDuration << ',' << config_.maxTransmitDuration
+            << "], step " << config_.transmitStep << ", target ["
+            << (int)config_.targetLow << ',' << (int)config_.targetHigh << "])";
+        throw std::runtime_error(oss.str());
+    }
+}
+
+AutoGainController::Ptr AutoGainController::Create(const Config& config,
+                                                   uint8_t gainSetting,
+                                                   uint16_t transmitDuration)
+{
+    return Ptr(new AutoGainController(config, gainSetting, transmitDuration));
+}
+
+bool AutoGainController::decrease()
+{
+    if(transmitDuration_ > config_.minTransmitDuration) {
+        long duration = std::min<long>(transmitDuration_ - 1,
+                                       std::lround(transmitDuration_ / config_.transmitStep));
+        transmitDuration_ = std::max<long>(duration, config_.minTransmitDuration);
+        return true;
+    }
+    if(gainSetting_ > 0) {
+        gainSetting_--;
+        return true;
+    }
+    return false;
+}
+
+bool AutoGainController::increase()
+{
+    if(transmitDuration_ < config_.maxTransmitDuration) {
+        long duration = std::max<long>(transmitDuration_ + 1,
+                                       std::lround(transmitDuration_ * config_.transmitStep));
+        transmitDuration_ = std::min<long>(duration, config_.maxTransmitDuration);
+        return true;
+    }
+    if(gainSetting_ < MaxGainSetting) {
+        gainSetting_++;
+        return true;
+    }
+    return false;
+}
+
+bool AutoGainController::update(const IntensityHistogram& stats,
+                                const PingParameters& rowParameters)
+{
+    if(rowParameters.gain_setting      != gainSetting_ ||
+       rowParameters.transmit_duration != transmitDuration_)
+    {
+        // Row acquired before the last change. If the device keeps
+        // answering with other settings (it clamps transmit_duration
+        // depending on the range), its settings are adopted.
+        if(++pendingPings_ <= MaxPendingPings) {
+            return false;
+        }
+        gainSetting_      = std::min(rowParameters.gain_setting, MaxGainSetting);
+        transmitDuration_ = rowParameters.transmit_duration;
+    }
+    pendingPings_ = 0;
+    if(stats.count() == 0) {
+        return false;
+    }
+
+    uint8_t level = stats.percentile(config_.percentile);
+    bool changed = false;
+    if(stats.fraction_above(config_.saturationLevel) > config_.maxSaturation
+       || level > config_.targetHigh)
+    {
+        changed = this->decrease();
+    }
+    else if(level < config_.targetLow) {
+        changed = this->increase();
+    }
+    if(changed) {
+        adjustmentCount_++;
+    }
+    return changed;
+}
+
+bool AutoGainController::update(const DeviceData& row)
+{
+    IntensityHistogram stats;
+    stats.add(row.data(), row_sample_count(row));
+    return this->update(stats, row.ping_parameters());
+}
+
+Transducer::Config AutoGainController::apply(const Transducer::Config& base) const
+{
+    Transducer::Config config = base;
+    config.gain_setting      = gainSetting_;
+    config.transmit_duration = transmitDuration_;
+    return config;
+}
+
+} //namespace ping360
+} //namespace ping_protocol
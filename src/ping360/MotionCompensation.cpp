@@ -0,0 +1,413 @@
+#include <ping_protocol/ping360/MotionCompensation.h>
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+#include <fstream>
+#include <cctype>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ping_protocol { namespace ping360 {
+
+namespace {
+
+constexpr unsigned int BatchSize = 256;
+
+double wrap_angle(double angle)
+{
+    return angle - 2.0*M_PI*std::floor((angle + M_PI) / (2.0*M_PI));
+}
+
+/**
+ * Grid cell of each footprint point (u,v) for a beam at angle phi from
+ * north, with the sonar at (column, row) = (a, b) :
+ *     column = a + sin(phi) u + cos(phi) v
+ *     row    = b - cos(phi) u + sin(phi) v
+ * cells[k] is row*width + column, or -1 outside the grid.
+ */
+void transform_points(const float* u, const float* v, unsigned int count,
+                      float a, float b, float c, float s,
+                      unsigned int width, unsigned int height, int32_t* cells)
+{
+    unsigned int k = 0;
+#ifdef __SSE2__
+    const __m128  va = _mm_set1_ps(a);
+    const __m128  vb = _mm_set1_ps(b);
+    const __m128  vc = _mm_set1_ps(c);
+    const __m128  vs = _mm_set1_ps(s);
+    const __m128  zero = _mm_setzero_ps();
+    const __m128  fw = _mm_set1_ps((float)width);
+    const __m128  fh = _mm_set1_ps((float)height);
+    const __m128i iw = _mm_set1_epi32(width);
+    const __m128i outside = _mm_set1_epi32(-1);
+    for(; k + 4 <= count; k += 4) {
+        __m128 pu = _mm_loadu_ps(u + k);
+        __m128 pv = _mm_loadu_ps(v + k);
+        __m128 column = _mm_add_ps(va, _mm_add_ps(_mm_mul_ps(vs, pu), _mm_mul_ps(vc, pv)));
+        __m128 row    = _mm_add_ps(vb, _mm_sub_ps(_mm_mul_ps(vs, pv), _mm_mul_ps(vc, pu)));
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(column, zero), _mm_cmplt_ps(column, fw)),
+                                   _mm_and_ps(_mm_cmpge_ps(row,    zero), _mm_cmplt_ps(row,    fh)));
+
+        // truncation is a floor for the inside points. row*width with
+        // 32 bits lanes (no mullo_epi32 before SSE4.1).
+        __m128i ic = _mm_cvttps_epi32(column);
+        __m128i ir = _mm_cvttps_epi32(row);
+        __m128i even = _mm_mul_epu32(ir, iw);
+        __m128i odd  = _mm_mul_epu32(_mm_srli_si128(ir, 4), iw);
+        __m128i offsets = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+                                             _mm_shuffle_epi32(odd,  _MM_SHUFFLE(0,0,2,0)));
+        __m128i index = _mm_add_epi32(offsets, ic);
+        index = _mm_or_si128(index, _mm_andnot_si128(_mm_castps_si128(inside), outside));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(cells + k), index);
+    }
+#endif
+    for(; k < count; k++) {
+        float column = a + (s*u[k] + c*v[k]);
+        float row    = b + (s*v[k] - c*u[k]);
+        if(column >= 0.0f && column < width && row >= 0.0f && row < height) {
+            cells[k] = (int32_t)row*width + (int32_t)column;
+        }
+        else {
+            cells[k] = -1;
+        }
+    }
+}
+
+} //namespace
+
+PoseInterpolator::PoseInterpolator(double maxGap) :
+    maxGap_(maxGap)
+{}
+
+PoseInterpolator::Ptr PoseInterpolator::Create(double maxGap)
+{
+    return Ptr(new PoseInterpolator(maxGap));
+}
+
+bool PoseInterpolator::add(const Pose& pose)
+{
+    if(!poses_.empty() && pose.time <= poses_.back().time) {
+        return false;
+    }
+    poses_.push_back(pose);
+    return true;
+}
+
+void PoseInterpolator::discard_before(double time)
+{
+    while(poses_.size() > 1 && poses_[1].time <= time) {
+        poses_.pop_front();
+    }
+}
+
+bool PoseInterpolator::interpolate(double time, Pose& out) const
+{
+    auto next = std::upper_bound(poses_.begin(), poses_.end(), time,
+        [](double t, const Pose& pose) { return t < pose.time; });
+    if(next == poses_.begin()) {
+        return false;
+    }
+    const Pose& p0 = *(next - 1);
+    if(next == poses_.end()) {
+        if(p0.time != time) {
+            return false;
+        }
+        out = p0;
+        return true;
+    }
+    const Pose& p1 = *next;
+    if(p1.time - p0.time > maxGap_) {
+        return false;
+    }
+
+    double alpha = (time - p0.time) / (p1.time - p0.time);
+    out.time    = time;
+    out.x       = p0.x + alpha*(p1.x - p0.x);
+    out.y       = p0.y + alpha*(p1.y - p0.y);
+    out.heading = wrap_angle(p0.heading + alpha*wrap_angle(p1.heading - p0.heading));
+    return true;
+}
+
+std::vector<Pose> PoseInterpolator::load_csv(const std::string& path)
+{
+    std::ifstream f(path);
+    if(!f) {
+        std::ostringstream oss;
+        oss << "PoseInterpolator : could not open '" << path << "'";
+        throw std::runtime_error(oss.str());
+    }
+
+    std::vector<Pose> poses;
+    std::string line;
+    for(unsigned int lineNumber = 1; std::getline(f, line); lineNumber++) {
+        auto first = line.find_first_not_of(" \t");
+        if(first == std::string::npos
+           || !(std::isdigit(line[first]) || line[first] == '-'
+                || line[first] == '+' || line[first] == '.'))
+        {
+            continue;
+        }
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream iss(line);
+        Pose pose;
+        if(!(iss >> pose.time >> pose.x >> pose.y >> pose.heading)) {
+            std::ostringstream oss;
+            oss << "PoseInterpolator : invalid pose line " << lineNumber
+                << " in '" << path << "'";
+            throw std::runtime_error(oss.str());
+        }
+        pose.heading *= M_PI / 180.0;
+        poses.push_back(pose);
+    }
+    return poses;
+}
+
+constexpr unsigned int MotionCompensatedAssembler::AngleCount;
+
+MotionCompensatedAssembler::MotionCompensatedAssembler(const Config& config) :
+    config_(config),
+    poses_(config.maxPoseGap),
+    sums_(config.width*config.height, 0),
+    counts_(config.width*config.height, 0),
+    sampleCount_(0),
+    samplePeriod_(0),
+    sampleEnds_(1, 0),
+    filled_(AngleCount, 0),
+    sweepStarted_(false)
+{
+    if(config_.cellSize <= 0.0f || config_.width == 0 || config_.height == 0
+       || config_.width > (1u << 15) || config_.height > (1u << 15)
+       || config_.angleStep == 0 || config_.angleStep > AngleCount)
+    {
+        std::ostringstream oss;
+        oss << "MotionCompensatedAssembler : invalid configuration (cell size "
+            << config_.cellSize << ", grid " << config_.width << 'x' << config_.height
+            << ", angle step " << config_.angleStep << ')';
+        throw std::runtime_error(oss.str());
+    }
+    std::memset(&stats_, 0, sizeof(stats_));
+}
+
+MotionCompensatedAssembler::Ptr MotionCompensatedAssembler::Create(const Config& config)
+{
+    return Ptr(new MotionCompensatedAssembler(config));
+}
+
+MotionCompensatedAssembler::Statistics MotionCompensatedAssembler::statistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void MotionCompensatedAssembler::set_sweep_callback(const SweepCallback& callback)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    sweepCallback_ = callback;
+}
+
+void MotionCompensatedAssembler::clear_grid()
+{
+    std::fill(sums_.begin(),   sums_.end(),   0);
+    std::fill(counts_.begin(), counts_.end(), 0);
+}
+
+void MotionCompensatedAssembler::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    this->clear_grid();
+    std::fill(filled_.begin(), filled_.end(), 0);
+    sweepStarted_ = false;
+}
+
+void MotionCompensatedAssembler::set_origin(double x, double y)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_.originX = x;
+    config_.originY = y;
+    this->clear_grid();
+    std::fill(filled_.begin(), filled_.end(), 0);
+    sweepStarted_ = false;
+}
+
+void MotionCompensatedAssembler::update_footprint(uint16_t sampleCount,
+                                                  uint16_t samplePeriod)
+{
+    sampleCount_  = sampleCount;
+    samplePeriod_ = samplePeriod;
+    footprintU_.clear();
+    footprintV_.clear();
+    footprintSamples_.clear();
+    sampleEnds_.assign(sampleCount_ + 1, 0);
+
+    // sample_period is in 25ns ticks, the wave travels back and forth.
+    float sampleLength = 0.5f * config_.soundSpeed * samplePeriod_ * 25.0e-9f
+                       / config_.cellSize;
+    if(sampleLength <= 0.0f) {
+        return;
+    }
+
+    // Points at most half a cell apart along and across the beam, so that
+    // the transformed footprint leaves no hole in the grid.
+    constexpr float Spacing = 0.5f;
+    float wedge = config_.angleStep * 2.0f * M_PI / AngleCount;
+    unsigned int radialSteps = std::ceil(sampleLength / Spacing);
+    for(unsigned int sample = 0; sample < sampleCount_; sample++) {
+        for(unsigned int i = 0; i < radialSteps; i++) {
+            float range = (sample + (i + 0.5f) / radialSteps) * sampleLength;
+            unsigned int lateralSteps = std::max(1.0f, std::ceil(range * wedge / Spacing));
+            for(unsigned int j = 0; j < lateralSteps; j++) {
+                float angle = ((j + 0.5f) / lateralSteps - 0.5f) * wedge;
+                footprintU_.push_back(range * std::cos(angle));
+                footprintV_.push_back(range * std::sin(angle));
+                footprintSamples_.push_back(sample);
+            }
+        }
+        sampleEnds_[sample + 1] = footprintU_.size();
+    }
+}
+
+void MotionCompensatedAssembler::check_sweep(const PingParameters& params)
+{
+    unsigned int angle = params.angle % AngleCount;
+    if(sweepStarted_ && (params.number_of_samples != sampleCount_
+                         || params.sample_period != samplePeriod_
+                         || filled_[angle]))
+    {
+        stats_.sweepCount++;
+        if(sweepCallback_) {
+            sweepCallback_(*this);
+        }
+        if(config_.clearOnSweep) {
+            this->clear_grid();
+        }
+        std::fill(filled_.begin(), filled_.end(), 0);
+    }
+    filled_[angle] = 1;
+    sweepStarted_  = true;
+}
+
+void MotionCompensatedAssembler::place(const DeviceData& row, const Pose& pose)
+{
+    const PingParameters& params = row.ping_parameters();
+    this->check_sweep(params);
+    if(params.number_of_samples != sampleCount_ || params.sample_period != samplePeriod_) {
+        this->update_footprint(params.number_of_samples, params.sample_period);
+    }
+
+    // data_length is read from the wire : do not trust it further than the
+    // payload actually received.
+    std::size_t available = row.payload_length() > sizeof(DeviceData::Metadata) ?
+        row.payload_length() - sizeof(DeviceData::Metadata) : 0;
+    std::size_t count = std::min<std::size_t>(row.metadata().data_length, available);
+    unsigned int pointCount = sampleEnds_[std::min<std::size_t>(count, sampleCount_)];
+
+    double ch = std::cos(pose.heading), sh = std::sin(pose.heading);
+    double x = pose.x + ch*config_.forwardOffset - sh*config_.starboardOffset;
+    double y = pose.y + sh*config_.forwardOffset + ch*config_.starboardOffset;
+    double phi = pose.heading + config_.headingOffset
+               + (params.angle % AngleCount) * 2.0*M_PI / AngleCount;
+
+    float a = (y - config_.originY) / config_.cellSize + 0.5*config_.width;
+    float b = (config_.originX - x) / config_.cellSize + 0.5*config_.height;
+    float c = std::cos(phi);
+    float s = std::sin(phi);
+
+    const uint8_t* data = row.data();
+    int32_t cells[BatchSize];
+    for(unsigned int first = 0; first < pointCount; first += BatchSize) {
+        unsigned int n = std::min(BatchSize, pointCount - first);
+        transform_points(footprintU_.data() + first, footprintV_.data() + first, n,
+                         a, b, c, s, config_.width, config_.height, cells);
+        const uint16_t* samples = footprintSamples_.data() + first;
+        for(unsigned int k = 0; k < n; k++) {
+            if(cells[k] >= 0) {
+                sums_[cells[k]] += data[samples[k]];
+                counts_[cells[k]]++;
+            }
+        }
+    }
+    stats_.placedCount++;
+    stats_.pointCount += pointCount;
+}
+
+void MotionCompensatedAssembler::process_pending()
+{
+    bool placed = false;
+    double lastTime = 0.0;
+    while(!pending_.empty() && !poses_.empty()
+          && pending_.front().time <= poses_.last_time())
+    {
+        const PendingRow& pending = pending_.front();
+        Pose pose;
+        if(poses_.interpolate(pending.time, pose)) {
+            this->place(pending.row, pose);
+            placed   = true;
+            lastTime = pending.time;
+        }
+        else {
+            stats_.droppedCount++;
+        }
+        pending_.pop_front();
+    }
+    if(placed) {
+        poses_.discard_before(lastTime - config_.poseHistory);
+    }
+}
+
+void MotionCompensatedAssembler::add_pose(const Pose& pose)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    poses_.add(pose);
+    this->process_pending();
+}
+
+void MotionCompensatedAssembler::add_poses(const std::vector<Pose>& poses)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(const auto& pose : poses) {
+        poses_.add(pose);
+    }
+    this->process_pending();
+}
+
+void MotionCompensatedAssembler::add_row(const DeviceData& row, double timestamp)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.rowCount++;
+
+    double time = timestamp + config_.timeOffset;
+    if(pending_.empty() && !poses_.empty() && time <= poses_.last_time()) {
+        Pose pose;
+        if(poses_.interpolate(time, pose)) {
+            this->place(row, pose);
+            poses_.discard_before(time - config_.poseHistory);
+        }
+        else {
+            stats_.droppedCount++;
+        }
+        return;
+    }
+
+    // Waiting for the poses covering this row.
+    if(pending_.size() >= config_.maxPendingRows) {
+        pending_.pop_front();
+        stats_.droppedCount++;
+    }
+    pending_.push_back(PendingRow({time, row}));
+}
+
+void MotionCompensatedAssembler::image(std::vector<uint8_t>& out) const
+{
+    out.resize(sums_.size());
+    for(std::size_t n = 0; n < sums_.size(); n++) {
+        out[n] = counts_[n] ? (sums_[n] + counts_[n] / 2) / counts_[n] : 0;
+    }
+}
+
+} //namespace ping360
+} //namespace ping_protocol
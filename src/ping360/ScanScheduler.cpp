@@ -0,0 +1,224 @@
+#include <ping_protocol/ping360/ScanScheduler.h>
+
+#include <cmath>
+#include <sstream>
+#include <algorithm>
+
+namespace ping_protocol { namespace ping360 {
+
+ScanScheduler::ScanScheduler(const Config& config) :
+    config_(config),
+    current_(-1),
+    cursor_(0),
+    step_(1),
+    lastUpdate_(Clock::now())
+{
+    if(config_.sectorCount == 0 || config_.sectorCount > AngleCount
+       || config_.fineStep == 0 || config_.coarseStep < config_.fineStep)
+    {
+        std::ostringstream oss;
+        oss << "ScanScheduler : invalid configuration (" << config_.sectorCount
+            << " sectors, steps " << config_.fineStep << '/' << config_.coarseStep << ')';
+        throw std::runtime_error(oss.str());
+    }
+    Sector sector;
+    sector.basePriority = 0.0f;
+    sector.boost        = 0.0f;
+    sector.pass         = 0.0;
+    sector.offset       = 0;
+    sector.passCount    = 0;
+    sector.refreshRate  = 0.0f;
+    sector.lastComplete = lastUpdate_;
+    sectors_.assign(config_.sectorCount, sector);
+}
+
+ScanScheduler::Ptr ScanScheduler::Create(const Config& config)
+{
+    return Ptr(new ScanScheduler(config));
+}
+
+unsigned int ScanScheduler::sector_start(unsigned int sector) const
+{
+    return (sector * AngleCount) / sectors_.size();
+}
+
+unsigned int ScanScheduler::sector_of(unsigned int angle) const
+{
+    return ((angle % AngleCount) * sectors_.size()) / AngleCount;
+}
+
+float ScanScheduler::priority(const Sector& sector) const
+{
+    return std::min(1.0f, std::max(0.0f, sector.basePriority + sector.boost));
+}
+
+unsigned int ScanScheduler::step_for(float priority) const
+{
+    return std::lround(config_.coarseStep
+        + priority * ((float)config_.fineStep - (float)config_.coarseStep));
+}
+
+void ScanScheduler::set_priority(unsigned int sector, float priority)
+{
+    if(sector >= sectors_.size()) {
+        std::ostringstream oss;
+        oss << "ScanScheduler : invalid sector index (" << sector << ')';
+        throw std::runtime_error(oss.str());
+    }
+    sectors_[sector].basePriority = priority;
+}
+
+void ScanScheduler::set_priority_map(const std::vector<float>& priorities)
+{
+    if(priorities.size() != sectors_.size()) {
+        std::ostringstream oss;
+        oss << "ScanScheduler : priority map size does not match sector count ("
+            << priorities.size() << '/' << sectors_.size() << ')';
+        throw std::runtime_error(oss.str());
+    }
+    for(unsigned int n = 0; n < sectors_.size(); n++) {
+        sectors_[n].basePriority = priorities[n];
+    }
+}
+
+void ScanScheduler::raise_priority(unsigned int angle, float amount)
+{
+    auto& sector = sectors_[this->sector_of(angle)];
+    sector.boost = std::min(1.0f, sector.boost + amount);
+}
+
+void ScanScheduler::decay_boosts(Clock::time_point now)
+{
+    float elapsed = std::chrono::duration<float>(now - lastUpdate_).count();
+    lastUpdate_ = now;
+    if(elapsed <= 0.0f || config_.boostHalfLife <= 0.0f) {
+        return;
+    }
+    float factor = std::exp2(-elapsed / config_.boostHalfLife);
+    for(auto& sector : sectors_) {
+        sector.boost *= factor;
+    }
+}
+
+void ScanScheduler::start_pass(Clock::time_point now)
+{
+    // Overdue sectors first, most overdue one.
+    auto maxInterval = std::chrono::duration<float>(
+        config_.minRefreshRate > 0.0f ? 1.0f / config_.minRefreshRate : INFINITY);
+    int chosen = -1;
+    auto oldest = now;
+    for(unsigned int n = 0; n < sectors_.size(); n++) {
+        if(now - sectors_[n].lastComplete > maxInterval
+           && sectors_[n].lastComplete < oldest)
+        {
+            chosen = n;
+            oldest = sectors_[n].lastComplete;
+        }
+    }
+
+    // Stride scheduling otherwise. Ties are broken by choosing the sector
+    // closest to the previous one to limit head travel.
+    if(chosen < 0) {
+        double minPass = INFINITY;
+        unsigned int minDistance = AngleCount;
+        for(unsigned int n = 0; n < sectors_.size(); n++) {
+            unsigned int distance = current_ < 0 ? 0 :
+                std::min((n + sectors_.size() - current_) % sectors_.size(),
+                         (current_ + sectors_.size() - n) % sectors_.size());
+            if(sectors_[n].pass < minPass
+               || (sectors_[n].pass == minPass && distance < minDistance))
+            {
+                chosen      = n;
+                minPass     = sectors_[n].pass;
+                minDistance = distance;
+            }
+        }
+    }
+
+    auto& sector = sectors_[chosen];
+    current_ = chosen;
+    step_    = this->step_for(this->priority(sector));
+    cursor_  = this->sector_start(chosen) + sector.offset % step_;
+    sector.offset++;
+
+    // Sector time share is proportional to its weight.
+    unsigned int width = this->sector_start(chosen + 1) - this->sector_start(chosen);
+    float weight = config_.minWeight + this->priority(sector);
+    sector.pass += ((width + step_ - 1) / step_) / std::max(weight, 1.0e-6f);
+
+    // Keeping virtual times bounded, only differences matter.
+    double minPass = INFINITY;
+    for(const auto& s : sectors_) minPass = std::min(minPass, s.pass);
+    for(auto& s : sectors_)       s.pass -= minPass;
+}
+
+void ScanScheduler::complete_pass(Clock::time_point now)
+{
+    auto& sector = sectors_[current_];
+    float interval = std::chrono::duration<float>(now - sector.lastComplete).count();
+    if(sector.passCount > 0 && interval > 0.0f) {
+        // exponential smoothing of the observed refresh rate
+        sector.refreshRate = 0.8f*sector.refreshRate + 0.2f / interval;
+    }
+    sector.passCount++;
+    sector.lastComplete = now;
+    current_ = -1;
+}
+
+unsigned int ScanScheduler::next_angle(Clock::time_point now)
+{
+    this->decay_boosts(now);
+    if(current_ < 0 || cursor_ >= this->sector_start(current_ + 1)) {
+        if(current_ >= 0) {
+            this->complete_pass(now);
+        }
+        this->start_pass(now);
+    }
+    unsigned int angle = cursor_;
+    cursor_ += step_;
+    return angle % AngleCount;
+}
+
+Transducer::Config ScanScheduler::next_config(const Transducer::Config& base,
+                                              Clock::time_point now)
+{
+    Transducer::Config config = base;
+    config.angle = this->next_angle(now);
+    return config;
+}
+
+void ScanScheduler::report(const DeviceData& row)
+{
+    if(!detector_) {
+        return;
+    }
+    float increase = detector_(row);
+    if(increase > 0.0f) {
+        this->raise_priority(row.ping_parameters().angle, increase);
+    }
+}
+
+ScanScheduler::SectorStats ScanScheduler::sector_stats(unsigned int sector) const
+{
+    const auto& s = sectors_.at(sector);
+    SectorStats res;
+    res.startAngle  = this->sector_start(sector);
+    res.endAngle    = this->sector_start(sector + 1);
+    res.priority    = this->priority(s);
+    res.step        = this->step_for(res.priority);
+    res.passCount   = s.passCount;
+    res.refreshRate = s.refreshRate;
+    return res;
+}
+
+std::vector<ScanScheduler::SectorStats> ScanScheduler::stats() const
+{
+    std::vector<SectorStats> res(sectors_.size());
+    for(unsigned int n = 0; n < sectors_.size(); n++) {
+        res[n] = this->sector_stats(n);
+    }
+    return res;
+}
+
+} //namespace ping360
+} //namespace ping_protocol
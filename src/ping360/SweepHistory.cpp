@@ -0,0 +1,379 @@
+#include <ping_protocol/ping360/SweepHistory.h>
+
+#include <sstream>
+#include <limits>
+#include <algorithm>
+
+namespace ping_protocol { namespace ping360 {
+
+constexpr uint64_t SweepHistory::NotFound;
+
+SweepHistory::Tier::Tier(unsigned int capacity, uint16_t maxSamples,
+                         unsigned int bits, unsigned int decimation) :
+    capacity_(capacity),
+    bits_(bits),
+    decimation_(decimation),
+    slotSize_((((maxSamples + decimation - 1) / decimation)*bits + 7) / 8),
+    records_(capacity),
+    slab_(capacity*slotSize_),
+    begin_(0),
+    end_(0),
+    last_(capacity > 0 ? AngleCount : 0, NotFound)
+{}
+
+std::size_t SweepHistory::Tier::memory_usage() const
+{
+    return sizeof(Record)*records_.size()
+         + slab_.size()
+         + sizeof(uint64_t)*last_.size();
+}
+
+void SweepHistory::Tier::clear()
+{
+    begin_ = end_;
+    std::fill(last_.begin(), last_.end(), NotFound);
+}
+
+void SweepHistory::Tier::push(Clock::rep timestamp, const PingParameters& params,
+                              const uint8_t* data, std::size_t count)
+{
+    if(this->full()) {
+        begin_++;
+    }
+    uint64_t seq = end_;
+    Record& record     = records_[seq % capacity_];
+    unsigned int angle = params.angle % AngleCount;
+    this->link(record, last_[angle]);
+    last_[angle] = seq;
+
+    record.seq         = seq;
+    record.timestamp   = timestamp;
+    record.parameters  = params;
+    record.sampleCount = std::min<std::size_t>(count, (slotSize_*8 / bits_)*decimation_);
+
+    uint8_t* dst = slab_.data() + slotSize_*(seq % capacity_);
+    if(bits_ == 8 && decimation_ == 1) {
+        std::memcpy(dst, data, record.sampleCount);
+    }
+    else {
+        // max decimation preserves echoes better than averaging
+        std::memset(dst, 0, slotSize_);
+        unsigned int shift = 8 - bits_;
+        for(std::size_t i = 0, j = 0; i < record.sampleCount; i += decimation_, j++) {
+            uint8_t value = data[i];
+            for(std::size_t k = i + 1; k < std::min<std::size_t>(i + decimation_, record.sampleCount); k++) {
+                value = std::max(value, data[k]);
+            }
+            dst[(j*bits_) / 8] |= (value >> shift) << ((j*bits_) % 8);
+        }
+    }
+    end_++;
+}
+
+void SweepHistory::Tier::decode(uint64_t seq, uint8_t* dst) const
+{
+    const Record&  record = this->record(seq);
+    const uint8_t* src    = this->slot(seq);
+    if(bits_ == 8 && decimation_ == 1) {
+        std::memcpy(dst, src, record.sampleCount);
+        return;
+    }
+    unsigned int mask = (1u << bits_) - 1;
+    uint8_t levels[256];
+    for(unsigned int q = 0; q <= mask; q++) {
+        levels[q] = (255*q) / mask;
+    }
+    for(std::size_t i = 0, j = 0; i < record.sampleCount; i += decimation_, j++) {
+        uint8_t value = levels[(src[(j*bits_) / 8] >> ((j*bits_) % 8)) & mask];
+        std::memset(dst + i, value,
+                    std::min<std::size_t>(decimation_, record.sampleCount - i));
+    }
+}
+
+void SweepHistory::Tier::read(uint64_t seq, Row& out) const
+{
+    const Record& record = this->record(seq);
+    out.timestamp  = Clock::time_point(Clock::duration(record.timestamp));
+    out.parameters = record.parameters;
+    out.samples.resize(record.sampleCount);
+    this->decode(seq, out.samples.data());
+}
+
+void SweepHistory::Tier::link(Record& record, uint64_t previous) const
+{
+    if(!this->contains(previous)) {
+        record.previous  = NotFound;
+        record.jump      = NotFound;
+        record.depth     = 0;
+        record.jumpDepth = 0;
+        return;
+    }
+    // Skew-binary jump links : the jump of the previous row is followed by
+    // one of the same length, both are merged in a jump twice as long.
+    const Record& parent = this->record(previous);
+    record.previous = previous;
+    record.depth    = parent.depth + 1;
+    if(this->contains(parent.jump)
+       && this->contains(this->record(parent.jump).jump)
+       && parent.depth - parent.jumpDepth
+          == parent.jumpDepth - this->record(parent.jump).jumpDepth)
+    {
+        record.jump      = this->record(parent.jump).jump;
+        record.jumpDepth = this->record(parent.jump).jumpDepth;
+    }
+    else {
+        record.jump      = previous;
+        record.jumpDepth = parent.depth;
+    }
+}
+
+uint64_t SweepHistory::Tier::lower_bound(Clock::rep timestamp) const
+{
+    uint64_t first = begin_, last = end_;
+    while(first < last) {
+        uint64_t middle = first + (last - first) / 2;
+        if(this->record(middle).timestamp < timestamp)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    return first;
+}
+
+uint64_t SweepHistory::Tier::upper_bound(Clock::rep timestamp) const
+{
+    uint64_t first = begin_, last = end_;
+    while(first < last) {
+        uint64_t middle = first + (last - first) / 2;
+        if(this->record(middle).timestamp <= timestamp)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    return first;
+}
+
+uint64_t SweepHistory::Tier::find(unsigned int angle, Clock::rep timestamp) const
+{
+    if(capacity_ == 0) {
+        return NotFound;
+    }
+    // Walks back the rows of the angle, taking a jump link when it does not
+    // go past the row searched for. Evicted rows end the search.
+    uint64_t seq = last_[angle % AngleCount];
+    while(this->contains(seq) && this->record(seq).timestamp > timestamp) {
+        const Record& record = this->record(seq);
+        if(this->contains(record.jump)
+           && this->record(record.jump).timestamp > timestamp)
+        {
+            seq = record.jump;
+        }
+        else {
+            seq = record.previous;
+        }
+    }
+    return this->contains(seq) ? seq : NotFound;
+}
+
+SweepHistory::SweepHistory(const Config& config) :
+    config_(config),
+    hot_(config.hotCapacity, config.maxSamples, 8, 1),
+    cold_(config.coldCapacity, config.maxSamples,
+          config.coldBits, std::max(config.coldDecimation, 1u)),
+    lastTimestamp_(std::numeric_limits<Clock::rep>::min())
+{
+    if(config_.hotCapacity == 0
+       || (config_.coldBits != 1 && config_.coldBits != 2
+           && config_.coldBits != 4 && config_.coldBits != 8))
+    {
+        std::ostringstream oss;
+        oss << "SweepHistory : invalid configuration (hot capacity "
+            << config_.hotCapacity << ", cold bits " << config_.coldBits << ')';
+        throw std::runtime_error(oss.str());
+    }
+}
+
+SweepHistory::Ptr SweepHistory::Create(const Config& config)
+{
+    return Ptr(new SweepHistory(config));
+}
+
+std::size_t SweepHistory::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hot_.size() + cold_.size();
+}
+
+std::size_t SweepHistory::memory_usage() const
+{
+    return hot_.memory_usage() + cold_.memory_usage();
+}
+
+void SweepHistory::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    hot_.clear();
+    cold_.clear();
+}
+
+void SweepHistory::insert(const DeviceData& row, Clock::time_point timestamp)
+{
+    std::size_t available = row.payload_length() > sizeof(DeviceData::Metadata) ?
+        row.payload_length() - sizeof(DeviceData::Metadata) : 0;
+    std::size_t count = std::min<std::size_t>(row.metadata().data_length, available);
+    count = std::min<std::size_t>(count, config_.maxSamples);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Binary searches need time ordered rows.
+    Clock::rep t = std::max(timestamp.time_since_epoch().count(), lastTimestamp_);
+    lastTimestamp_ = t;
+
+    if(hot_.full() && cold_.capacity() > 0) {
+        const Record& oldest = hot_.record(hot_.begin());
+        cold_.push(oldest.timestamp, oldest.parameters,
+                   hot_.slot(hot_.begin()), oldest.sampleCount);
+    }
+    hot_.push(t, row.ping_parameters(), row.data(), count);
+}
+
+bool SweepHistory::find(unsigned int angle, Clock::rep timestamp, Row& out) const
+{
+    uint64_t seq = hot_.find(angle, timestamp);
+    if(seq != NotFound) {
+        hot_.read(seq, out);
+        out.cold = false;
+        return true;
+    }
+    seq = cold_.find(angle, timestamp);
+    if(seq != NotFound) {
+        cold_.read(seq, out);
+        out.cold = true;
+        return true;
+    }
+    return false;
+}
+
+bool SweepHistory::latest(unsigned int angle, Row& out) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return this->find(angle, std::numeric_limits<Clock::rep>::max(), out);
+}
+
+bool SweepHistory::at(unsigned int angle, Clock::time_point timestamp, Row& out) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return this->find(angle, timestamp.time_since_epoch().count(), out);
+}
+
+void SweepHistory::query(const Tier& tier, Clock::rep t0, Clock::rep t1,
+                         unsigned int angleBegin, unsigned int angleEnd,
+                         std::vector<Row>& out, std::size_t& count) const
+{
+    if(tier.capacity() == 0 || t1 < t0) {
+        return;
+    }
+    uint64_t end = tier.upper_bound(t1);
+    for(uint64_t seq = tier.lower_bound(t0); seq < end; seq++) {
+        unsigned int angle = tier.record(seq).parameters.angle % AngleCount;
+        bool inRange = angleBegin <= angleEnd ?
+            angle >= angleBegin && angle < angleEnd :
+            angle >= angleBegin || angle < angleEnd;
+        if(!inRange) {
+            continue;
+        }
+        if(count == out.size()) {
+            out.emplace_back();
+        }
+        tier.read(seq, out[count]);
+        out[count].cold = &tier == &cold_;
+        count++;
+    }
+}
+
+std::size_t SweepHistory::query(Clock::time_point t0, Clock::time_point t1,
+                                std::vector<Row>& out,
+                                unsigned int angleBegin, unsigned int angleEnd) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::size_t count = 0;
+    Clock::rep r0 = t0.time_since_epoch().count();
+    Clock::rep r1 = t1.time_since_epoch().count();
+    this->query(cold_, r0, r1, angleBegin, angleEnd, out, count);
+    this->query(hot_,  r0, r1, angleBegin, angleEnd, out, count);
+    out.resize(count);
+    return count;
+}
+
+unsigned int SweepHistory::reconstruct(Clock::time_point timestamp,
+                                       Clock::duration window,
+                                       Sweep& out,
+                                       std::vector<uint8_t>& buffer) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Clock::rep t    = timestamp.time_since_epoch().count();
+    Clock::rep tMin = (timestamp - window).time_since_epoch().count();
+
+    // Most recent row gives the geometry.
+    const Tier* tier = &hot_;
+    uint64_t seq = hot_.upper_bound(t);
+    if(seq == hot_.begin()) {
+        tier = &cold_;
+        seq  = cold_.capacity() > 0 ? cold_.upper_bound(t) : 0;
+        if(seq == cold_.begin()) {
+            out.clear();
+            return 0;
+        }
+    }
+    seq--;
+    const Record& newest = tier->record(seq);
+    if(newest.timestamp < tMin) {
+        out.clear();
+        return 0;
+    }
+    if(out.same_geometry(newest.parameters)) {
+        out.clear();
+    }
+    else {
+        out.reset(newest.parameters.number_of_samples);
+    }
+
+    buffer.resize(config_.maxSamples);
+    unsigned int newestAngle = newest.parameters.angle % AngleCount;
+    unsigned int count = 0;
+    for(unsigned int angle = 0; angle < AngleCount; angle++) {
+        if(angle == newestAngle) {
+            continue;
+        }
+        const Tier* source = &hot_;
+        uint64_t rowSeq = hot_.find(angle, t);
+        if(rowSeq == NotFound) {
+            source = &cold_;
+            rowSeq = cold_.find(angle, t);
+        }
+        if(rowSeq == NotFound) {
+            continue;
+        }
+        const Record& record = source->record(rowSeq);
+        if(record.timestamp < tMin
+           || record.parameters.number_of_samples != newest.parameters.number_of_samples
+           || record.parameters.sample_period     != newest.parameters.sample_period)
+        {
+            continue;
+        }
+        source->decode(rowSeq, buffer.data());
+        out.set_row(record.parameters, buffer.data(), record.sampleCount);
+        count++;
+    }
+    // Inserted last so the sweep keeps its parameters.
+    tier->decode(seq, buffer.data());
+    out.set_row(newest.parameters, buffer.data(), newest.sampleCount);
+    count++;
+
+    return count;
+}
+
+} //namespace ping360
+} //namespace ping_protocol
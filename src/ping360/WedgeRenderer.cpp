@@ -0,0 +1,196 @@
+#include <ping_protocol/ping360/WedgeRenderer.h>
+
+#include <cmath>
+#include <sstream>
+
+namespace ping_protocol { namespace ping360 {
+
+WedgeRenderer::WedgeRenderer(unsigned int width, unsigned int angleStep,
+                             float soundSpeed) :
+    width_(width),
+    angleStep_(1),
+    soundSpeed_(soundSpeed),
+    sampleCount_(0),
+    samplePeriod_(0),
+    image_(width*width, 0),
+    offsets_(AngleCount + 1, 0),
+    bounds_(AngleCount, Rectangle::Empty())
+{
+    if(width_ == 0) {
+        throw std::runtime_error("WedgeRenderer : image width must be non-zero");
+    }
+    this->set_angle_step(angleStep);
+}
+
+WedgeRenderer::Ptr WedgeRenderer::Create(unsigned int width, unsigned int angleStep,
+                                         float soundSpeed)
+{
+    return Ptr(new WedgeRenderer(width, angleStep, soundSpeed));
+}
+
+float WedgeRenderer::range() const
+{
+    // sample_period is in 25ns ticks, the wave travels back and forth.
+    return 0.5f * soundSpeed_ * sampleCount_ * samplePeriod_ * 25.0e-9f;
+}
+
+void WedgeRenderer::set_angle_step(unsigned int angleStep)
+{
+    if(angleStep == 0 || angleStep > AngleCount) {
+        std::ostringstream oss;
+        oss << "WedgeRenderer : invalid angle step (" << angleStep << ')';
+        throw std::runtime_error(oss.str());
+    }
+    angleStep_ = angleStep;
+}
+
+void WedgeRenderer::clear()
+{
+    std::fill(image_.begin(), image_.end(), 0);
+}
+
+void WedgeRenderer::update_geometry(uint16_t sampleCount)
+{
+    sampleCount_ = sampleCount;
+
+    // First pass computes the angle of each pixel, second pass sorts pixels
+    // by angle (counting sort, pixels stay in raster order within an angle).
+    float radius = 0.5f*width_;
+    float toGradians = 0.5f*AngleCount / M_PI;
+    float toSamples  = sampleCount_ / radius;
+
+    std::vector<uint16_t> pixelAngles(image_.size());
+    std::vector<uint16_t> pixelSamples(image_.size());
+    std::vector<uint32_t> counts(AngleCount, 0);
+    for(unsigned int h = 0; h < width_; h++) {
+        float y = h + 0.5f - radius;
+        for(unsigned int w = 0; w < width_; w++) {
+            float x = w + 0.5f - radius;
+            auto pixel = h*width_ + w;
+            unsigned int sample = std::sqrt(x*x + y*y) * toSamples;
+            if(sample >= sampleCount_) {
+                pixelAngles[pixel] = AngleCount; // outside the sonar range
+                continue;
+            }
+            // angle 0 pointing up (-y), clockwise
+            float angle = std::atan2(x, -y) * toGradians;
+            auto bin = (unsigned int)std::lround(angle + AngleCount) % AngleCount;
+            pixelAngles[pixel]  = bin;
+            pixelSamples[pixel] = sample;
+            counts[bin]++;
+        }
+    }
+
+    offsets_[0] = 0;
+    for(unsigned int n = 0; n < AngleCount; n++) {
+        offsets_[n + 1] = offsets_[n] + counts[n];
+    }
+    pixels_.resize(offsets_[AngleCount]);
+    samples_.resize(offsets_[AngleCount]);
+    std::fill(bounds_.begin(), bounds_.end(), Rectangle::Empty());
+
+    std::vector<uint32_t> cursors(offsets_.begin(), offsets_.end() - 1);
+    for(unsigned int pixel = 0; pixel < image_.size(); pixel++) {
+        auto bin = pixelAngles[pixel];
+        if(bin >= AngleCount) {
+            continue;
+        }
+        pixels_[cursors[bin]]  = pixel;
+        samples_[cursors[bin]] = pixelSamples[pixel];
+        cursors[bin]++;
+
+        unsigned int w = pixel % width_, h = pixel / width_;
+        bounds_[bin].merge(Rectangle({w, h, w + 1, h + 1}));
+    }
+}
+
+Rectangle WedgeRenderer::wedge_bounds(unsigned int angle) const
+{
+    Rectangle res = Rectangle::Empty();
+    unsigned int first = angle + AngleCount - (angleStep_ - 1) / 2;
+    for(unsigned int n = 0; n < angleStep_; n++) {
+        res.merge(bounds_[(first + n) % AngleCount]);
+    }
+    return res;
+}
+
+Rectangle WedgeRenderer::render(const DeviceData& row)
+{
+    Rectangle dirty = Rectangle::Empty();
+    const auto& params = row.ping_parameters();
+    if(params.number_of_samples == 0) {
+        return dirty;
+    }
+    if(params.number_of_samples != sampleCount_) {
+        this->update_geometry(params.number_of_samples);
+        this->clear();
+        dirty = this->full_image();
+    }
+    else if(params.sample_period != samplePeriod_) {
+        // same pixel mapping, but the scale of the image changed
+        this->clear();
+        dirty = this->full_image();
+    }
+    samplePeriod_ = params.sample_period;
+
+    std::size_t available = row.payload_length() > sizeof(DeviceData::Metadata) ?
+        row.payload_length() - sizeof(DeviceData::Metadata) : 0;
+    std::size_t dataLength = std::min<std::size_t>(row.metadata().data_length, available);
+    const uint8_t* data = row.data();
+
+    unsigned int first = params.angle % AngleCount + AngleCount - (angleStep_ - 1) / 2;
+    for(unsigned int n = 0; n < angleStep_; n++) {
+        unsigned int bin = (first + n) % AngleCount;
+        const uint32_t* pixels  = pixels_.data()  + offsets_[bin];
+        const uint16_t* samples = samples_.data() + offsets_[bin];
+        unsigned int    count   = offsets_[bin + 1] - offsets_[bin];
+        if(dataLength >= sampleCount_) {
+            for(unsigned int k = 0; k < count; k++) {
+                image_[pixels[k]] = data[samples[k]];
+            }
+        }
+        else {
+            for(unsigned int k = 0; k < count; k++) {
+                image_[pixels[k]] = samples[k] < dataLength ? data[samples[k]] : 0;
+            }
+        }
+        dirty.merge(bounds_[bin]);
+    }
+    return dirty;
+}
+
+Rectangle WedgeRenderer::render(const Sweep& sweep)
+{
+    if(sweep.sample_count() == 0) {
+        return Rectangle::Empty();
+    }
+    if(sweep.sample_count() != sampleCount_) {
+        this->update_geometry(sweep.sample_count());
+    }
+    samplePeriod_ = sweep.sample_period();
+
+    for(unsigned int bin = 0; bin < AngleCount; bin++) {
+        const uint8_t* data = sweep.row(bin);
+        if(!sweep.has_row(bin)) {
+            // rows are spaced by the angle step : use the nearest filled row
+            // to fill the wedge, as render(DeviceData) would.
+            unsigned int n = 1;
+            for(; n < angleStep_; n++) {
+                if(sweep.has_row(bin + n)) { data = sweep.row(bin + n); break; }
+                if(sweep.has_row(bin + AngleCount - n)) {
+                    data = sweep.row(bin + AngleCount - n); break;
+                }
+            }
+            if(n >= angleStep_) {
+                data = nullptr;
+            }
+        }
+        for(unsigned int k = offsets_[bin]; k < offsets_[bin + 1]; k++) {
+            image_[pixels_[k]] = data ? data[samples_[k]] : 0;
+        }
+    }
+    return this->full_image();
+}
+
+} //namespace ping360
+} //namespace ping_protocol
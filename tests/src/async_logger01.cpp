@@ -0,0 +1,41 @@
+#include <iostream>
+#include <chrono>
+using namespace std;
+
+#include <ping_protocol/AsyncLogger.h>
+#include <ping_protocol/messages/format_utils.h>
+using namespace ping_protocol;
+
+int main()
+{
+    ping360::DeviceData::Metadata meta;
+    std::memset(&meta, 0, sizeof(meta));
+    meta.number_of_samples = 1200;
+    meta.data_length       = 1200;
+    ping360::DeviceData row(meta, std::vector<uint8_t>(1200));
+
+    char line[512];
+    cout.write(line, format_message(line, sizeof(line), row));
+    cout.write(line, format_message(line, sizeof(line), row, LogFormat::Json));
+    cout.write(line, format_message(line, sizeof(line), NotAcknowledged(2601, "busy"),
+                                    LogFormat::Json));
+    cout.write(line, format_message(line, sizeof(line), ping360::Transducer()));
+    cout << flush;
+
+    unsigned int count = 100000;
+    {
+        auto logger = AsyncLogger::Create(STDERR_FILENO, LogFormat::Json);
+        auto t0 = std::chrono::steady_clock::now();
+        for(unsigned int n = 0; n < count; n++) {
+            row.ping_parameters().angle = n % 400;
+            logger->log(row);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        cout << "log() : "
+             << std::chrono::duration<double, std::nano>(t1 - t0).count() / count
+             << "ns per message, dropped " << logger->dropped_count()
+             << '/' << count << endl;
+    }
+
+    return 0;
+}
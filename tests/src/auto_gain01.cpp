@@ -0,0 +1,68 @@
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <cmath>
+using namespace std;
+
+#include <ping_protocol/ping360/IntensityStats.h>
+using namespace ping_protocol;
+
+// Simulated device : echo intensities scale with the transmit duration and
+// with the gain setting (x4 per step), saturating at 255.
+ping360::DeviceData simulate_ping(const ping360::Transducer::Config& config,
+                                  const std::vector<float>& scene)
+{
+    ping360::DeviceData::Metadata meta;
+    std::memset(&meta, 0, sizeof(meta));
+    (ping360::PingParameters&)meta = config;
+    meta.data_length = scene.size();
+
+    float exposure = config.transmit_duration * std::pow(4.0f, config.gain_setting) / 100.0f;
+    std::vector<uint8_t> data(scene.size());
+    for(unsigned int n = 0; n < data.size(); n++) {
+        data[n] = std::min(255.0f, scene[n]*exposure);
+    }
+    return ping360::DeviceData(meta, data);
+}
+
+int main()
+{
+    std::mt19937 gen(0);
+    std::exponential_distribution<float> echo(1.0f / 4.0f);
+    std::vector<float> dimScene(1200), brightScene(1200);
+    for(unsigned int n = 0; n < dimScene.size(); n++) {
+        dimScene[n]    = echo(gen);
+        brightScene[n] = 40.0f*dimScene[n];
+    }
+
+    ping360::SweepStatistics stats;
+    ping360::AutoGainController controller;
+    auto base = ping360::Transducer::default_config();
+    base.number_of_samples = dimScene.size();
+
+    double statsTime = 0.0;
+    for(unsigned int ping = 0; ping < 1200; ping++) {
+        const auto& scene = ping < 600 ? dimScene : brightScene;
+        auto config = controller.apply(base);
+        config.angle = ping % 400;
+        auto row = simulate_ping(config, scene);
+
+        auto t0 = std::chrono::steady_clock::now();
+        const auto& rowStats = stats.add_row(row);
+        bool changed = controller.update(rowStats, row.ping_parameters());
+        statsTime += std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - t0).count();
+
+        if(changed || ping == 599 || ping == 1199) {
+            cout << "ping " << ping
+                 << " : p99 "        << (int)rowStats.percentile(0.99f)
+                 << ", saturation "  << rowStats.fraction_above(250)
+                 << ", sweep mean "  << stats.sweep().mean()
+                 << " -> gain "      << (int)controller.gain_setting()
+                 << ", transmit "    << controller.transmit_duration() << endl;
+        }
+    }
+    cout << "Statistics and control : " << statsTime / 1200 << " us per ping" << endl;
+
+    return 0;
+}
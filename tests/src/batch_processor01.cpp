@@ -0,0 +1,115 @@
+#include <iostream>
+#include <fstream>
+#include <thread>
+using namespace std;
+
+#include <ping_protocol/messages/frame_utils.h>
+#include <ping_protocol/ping360/BatchProcessor.h>
+#include <ping_protocol/ping360/WedgeRenderer.h>
+using namespace ping_protocol;
+
+uint64_t hash_bytes(const uint8_t* data, std::size_t size, uint64_t h = 1469598103934665603ull)
+{
+    for(std::size_t n = 0; n < size; n++) {
+        h = (h ^ data[n]) * 1099511628211ull;
+    }
+    return h;
+}
+
+void threshold(ping360::Sweep& sweep)
+{
+    for(std::size_t n = 0; n < sweep.size(); n++) {
+        if(sweep.data()[n] < 32) sweep.data()[n] = 0;
+    }
+}
+
+int main()
+{
+    // Recording of full turns with a geometry change, garbage between some
+    // frames, non DeviceData frames and valid frames embedded in the samples
+    // (which must not be taken for frames of the recording).
+    std::vector<uint8_t> recording;
+    ping360::DeviceData::Metadata meta;
+    std::memset(&meta, 0, sizeof(meta));
+    meta.sample_period = 80;
+
+    ProtocolVersion version;
+    for(unsigned int turn = 0; turn < 24; turn++) {
+        meta.number_of_samples = turn < 12 ? 1200 : 600;
+        meta.data_length       = meta.number_of_samples;
+        std::vector<uint8_t> data(meta.data_length);
+        for(unsigned int angle = 0; angle < 400; angle += 2) {
+            meta.angle = angle;
+            for(unsigned int n = 0; n < data.size(); n++) {
+                data[n] = (n*7 + angle*3 + turn*11) % 251;
+            }
+            std::memcpy(data.data() + (angle*13) % (data.size() - 32),
+                        version.data(), version.size());
+            ping360::DeviceData row(meta, data);
+            recording.insert(recording.end(), row.bytes().begin(), row.bytes().end());
+            if(angle % 50 == 0) {
+                recording.insert(recording.end(), version.data(), version.data() + version.size());
+                recording.push_back('B');
+                recording.push_back('R');
+                recording.push_back(0x42);
+            }
+        }
+    }
+
+    // Serial reference
+    std::vector<uint64_t> reference;
+    ping360::WedgeRenderer renderer(512);
+    ping360::SweepAssembler assembler([&](const ping360::Sweep& sweep) {
+        ping360::Sweep filtered = sweep;
+        threshold(filtered);
+        renderer.render(filtered);
+        reference.push_back(hash_bytes(renderer.image(), 512*512,
+                            hash_bytes(filtered.data(), filtered.size())));
+    });
+    std::size_t skipped = for_each_frame(recording.data(), recording.size(),
+        [&](const uint8_t* frame, std::size_t size) {
+            const MessageHeader* header = reinterpret_cast<const MessageHeader*>(frame);
+            if(header->message_id != ping360::DeviceData::MessageId) return;
+            ping360::DeviceData row(meta, std::vector<uint8_t>());
+            row.accomodate_for_message(*header);
+            std::memcpy(row.Message::data(), frame, size);
+            assembler.add_row(row);
+        });
+    assembler.flush();
+    cout << "Recording : " << recording.size() << " bytes, "
+         << reference.size() << " sweeps, " << skipped << " skipped bytes" << endl;
+
+    std::string path = "batch_processor01.bin";
+    {
+        std::ofstream f(path, std::ios::binary);
+        f.write((const char*)recording.data(), recording.size());
+    }
+
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+        auto config = ping360::BatchProcessor::default_config();
+        config.threadCount    = threads;
+        config.sweepsPerChunk = 1;
+        ping360::BatchProcessor processor(config);
+        processor.set_filter(threshold);
+
+        std::vector<uint64_t> hashes;
+        bool ordered = true;
+        processor.set_output([&](const ping360::BatchProcessor::Result& result) {
+            ordered &= result.index == hashes.size();
+            hashes.push_back(hash_bytes(result.image, 512*512,
+                             hash_bytes(result.sweep->data(), result.sweep->size())));
+        });
+        const auto& stats = processor.process_file(path);
+
+        cout << threads << " threads : " << stats.sweepCount << " sweeps, "
+             << stats.frameCount << " frames, " << stats.skippedBytes << " skipped bytes, "
+             << stats.stealCount << " steals, index " << 1000*stats.indexTime
+             << " ms, total " << 1000*stats.totalTime << " ms, "
+             << stats.sweeps_per_second() << " sweeps/s ("
+             << stats.sweeps_per_second_per_core() << " per core), ordered "
+             << ordered << ", matches serial " << (hashes == reference) << endl;
+    }
+
+    return 0;
+}
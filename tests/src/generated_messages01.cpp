@@ -0,0 +1,70 @@
+#include <iostream>
+using namespace std;
+
+#include <ping_protocol/messages/Ping360Messages.h>
+#include <ping_protocol/generated/common.h>
+#include <ping_protocol/generated/ping360.h>
+#include <ping_protocol/generated/ping1d.h>
+using namespace ping_protocol;
+
+namespace gen360 = ping_protocol::generated::ping360;
+
+struct Printer
+{
+    void operator()(const gen360::DeviceData& msg) const {
+        cout << gen360::DeviceData::Name << " : angle " << msg.angle()
+             << ", " << msg.data_length() << " samples, first sample "
+             << (unsigned int)msg.data()[0] << endl;
+    }
+    void operator()(const gen360::Transducer& msg) const {
+        cout << gen360::Transducer::Name << " : angle " << msg.angle()
+             << ", transmit " << (unsigned int)msg.transmit() << endl;
+    }
+    template <class T>
+    void operator()(const T&) const {
+        cout << T::Name << endl;
+    }
+};
+
+int main()
+{
+    // hand-written and generated layouts must agree
+    static_assert(sizeof(gen360::Transducer::Layout) == sizeof(ping360::Transducer::Config),
+                  "Transducer layouts differ");
+    static_assert(gen360::Transducer::FixedSize == ping360::Transducer::FixedSize,
+                  "Transducer sizes differ");
+    static_assert(sizeof(gen360::DeviceData::Layout) == sizeof(ping360::DeviceData::Metadata),
+                  "DeviceData layouts differ");
+
+    ping360::DeviceData::Metadata meta;
+    std::memset(&meta, 0, sizeof(meta));
+    meta.angle       = 123;
+    meta.data_length = 4;
+    ping360::DeviceData data(meta, std::vector<uint8_t>({7,8,9,10}));
+
+    auto config  = ping360::Transducer::default_config();
+    config.angle = 42;
+    ping360::Transducer transducer(config);
+    ping360::MotorOff   motorOff;
+
+    for(const Message* msg : std::vector<const Message*>({&data, &transducer, &motorOff})) {
+        if(!gen360::dispatch(msg->data(), msg->size(), Printer())) {
+            cout << "Could not dispatch message " << msg->header().message_id << endl;
+            return 1;
+        }
+    }
+
+    // Corrupted checksum
+    Message corrupted = transducer;
+    corrupted.payload()[2]++;
+    if(gen360::dispatch(corrupted.data(), corrupted.size(), Printer())) {
+        cout << "Corrupted message was not rejected" << endl;
+        return 1;
+    }
+
+    GeneralRequest requestMessage(5);
+    generated::common::GeneralRequest request(requestMessage);
+    cout << "GeneralRequest requested_id : " << request.requested_id() << endl;
+
+    return 0;
+}
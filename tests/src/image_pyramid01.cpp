@@ -0,0 +1,77 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+using namespace std;
+
+#include <ping_protocol/ping360/ImagePyramid.h>
+using namespace ping_protocol;
+
+bool same_levels(const ping360::ImagePyramid& a, const ping360::ImagePyramid& b)
+{
+    for(unsigned int level = 0; level < a.level_count(); level++) {
+        if(std::memcmp(a.level_data(level), b.level_data(level),
+                       a.width(level)*a.height(level)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    ping360::SweepPyramid pyramid(1024);
+
+    ping360::DeviceData::Metadata meta;
+    std::memset(&meta, 0, sizeof(meta));
+    meta.sample_period     = 80;
+    meta.number_of_samples = 1200;
+    meta.data_length       = 1200;
+    std::vector<uint8_t> data(meta.data_length);
+
+    // Second turn timed, the first one includes the renderer tables setup.
+    std::vector<ping360::DeviceData> rows;
+    for(unsigned int angle = 0; angle < 400; angle++) {
+        meta.angle = angle;
+        for(unsigned int n = 0; n < data.size(); n++) {
+            data[n] = (n / 50 + angle / 25) % 2 ? 255 : (n + 3*angle) % 97;
+        }
+        rows.push_back(ping360::DeviceData(meta, data));
+        pyramid.add_row(rows.back());
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    for(const auto& row : rows) {
+        pyramid.add_row(row);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    cout << "Full sweep : "
+         << std::chrono::duration<double, std::micro>(t1 - t0).count() / 400
+         << " us per row" << endl;
+
+    // Incremental updates must give the same levels as a full rebuild.
+    const auto& polar = pyramid.polar();
+    const auto& cartesian = pyramid.cartesian();
+    ping360::ImagePyramid polarRef(polar.width(), polar.height());
+    polarRef.update(polar.level_data(0), polar.width(),
+                    ping360::Rectangle({0, 0, polar.width(), polar.height()}));
+    ping360::ImagePyramid cartesianRef(cartesian.width(), cartesian.height());
+    cartesianRef.update(cartesian.level_data(0), cartesian.width(), pyramid.renderer().full_image());
+    cout << "Polar levels match full rebuild : " << same_levels(polar, polarRef) << endl
+         << "Cartesian levels match full rebuild : " << same_levels(cartesian, cartesianRef) << endl;
+
+    for(unsigned int level = 0; level < cartesian.level_count(); level++) {
+        cout << "Level " << level << " : polar "
+             << polar.width(level) << 'x' << polar.height(level) << " ("
+             << polar.tile_columns(level) << 'x' << polar.tile_rows(level) << " tiles), cartesian "
+             << cartesian.width(level) << 'x' << cartesian.height(level) << " ("
+             << cartesian.tile_columns(level) << 'x' << cartesian.tile_rows(level) << " tiles)" << endl;
+    }
+
+    auto tile = cartesian.tile(2, 0, 0);
+    std::ofstream f("image_pyramid01.pgm", std::ios::binary);
+    f << "P5\n" << tile.width << ' ' << tile.height << "\n255\n";
+    for(unsigned int y = 0; y < tile.height; y++) {
+        f.write((const char*)tile.data + y*tile.stride, tile.width);
+    }
+
+    return 0;
+}
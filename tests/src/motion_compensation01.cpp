@@ -0,0 +1,138 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+using namespace std;
+
+#include <ping_protocol/ping360/MotionCompensation.h>
+using namespace ping_protocol;
+
+// Three point reflectors seen from a vehicle moving at 1.5 m/s and turning
+// at 5 deg/s during a full turn of the head (one ping every 25 ms).
+const double targets[3][2] = {{8.0, 3.0}, {-4.0, 9.0}, {2.0, -7.0}};
+
+ping360::Pose vehicle_pose(double t)
+{
+    ping360::Pose pose;
+    pose.time    = t;
+    pose.heading = (30.0 + 5.0*t) * M_PI / 180.0;
+    pose.x       = 1.5*t*std::cos(M_PI / 4);
+    pose.y       = 1.5*t*std::sin(M_PI / 4);
+    return pose;
+}
+
+ping360::DeviceData make_ping(unsigned int angle, double t)
+{
+    ping360::DeviceData::Metadata meta;
+    std::memset(&meta, 0, sizeof(meta));
+    meta.angle             = angle;
+    meta.sample_period     = 444; // about 1.4 cm per sample
+    meta.number_of_samples = 1200;
+    meta.data_length       = 1200;
+    float sampleLength = 0.5f * 1500.0f * meta.sample_period * 25.0e-9f;
+
+    std::vector<uint8_t> data(meta.data_length, 10);
+    auto pose = vehicle_pose(t);
+    double beam = pose.heading + angle * 2.0*M_PI / 400;
+    for(const auto& target : targets) {
+        double dx = target[0] - pose.x, dy = target[1] - pose.y;
+        double bearing = std::remainder(std::atan2(dy, dx) - beam, 2.0*M_PI);
+        if(std::abs(bearing) > 0.5 * 2.0*M_PI / 400) continue;
+        unsigned int sample = std::sqrt(dx*dx + dy*dy) / sampleLength;
+        for(unsigned int n = sample - 2; n <= sample + 2 && n < data.size(); n++) {
+            data[n] = 250;
+        }
+    }
+    return ping360::DeviceData(meta, data);
+}
+
+// Mean distance (meters) of the bright cells to the nearest target.
+double spread(const ping360::MotionCompensatedAssembler& assembler)
+{
+    const auto& config = assembler.config();
+    std::vector<uint8_t> image;
+    assembler.image(image);
+    double sum = 0.0;
+    unsigned int count = 0;
+    for(unsigned int h = 0; h < assembler.height(); h++) {
+        for(unsigned int w = 0; w < assembler.width(); w++) {
+            if(image[h*assembler.width() + w] < 128) continue;
+            double x = config.originX + (0.5*assembler.height() - h - 0.5) * config.cellSize;
+            double y = config.originY + (w + 0.5 - 0.5*assembler.width()) * config.cellSize;
+            double d = 1.0e9;
+            for(const auto& target : targets) {
+                d = std::min(d, std::hypot(x - target[0], y - target[1]));
+            }
+            sum += d;
+            count++;
+        }
+    }
+    return count ? sum / count : -1.0;
+}
+
+int main()
+{
+    auto config = ping360::MotionCompensatedAssembler::default_config();
+    config.cellSize = 0.05f;
+    config.width    = 512;
+    config.height   = 512;
+
+    // Live : poses arrive at 20 Hz with a 100 ms latency, rows wait for them.
+    ping360::MotionCompensatedAssembler live(config);
+    // Offline : poses read from a file.
+    ping360::MotionCompensatedAssembler offline(config);
+    // Reference without compensation : every row placed at the first pose.
+    ping360::MotionCompensatedAssembler fixed(config);
+
+    std::ofstream csv("motion_compensation01.csv");
+    csv.precision(12);
+    csv << "time,x,y,heading\n";
+    for(unsigned int n = 0; n <= 220; n++) {
+        auto pose = vehicle_pose(0.05*n);
+        csv << pose.time << ',' << pose.x << ',' << pose.y << ','
+            << pose.heading * 180.0 / M_PI << '\n';
+    }
+    csv.close();
+    offline.add_poses(ping360::PoseInterpolator::load_csv("motion_compensation01.csv"));
+    fixed.add_pose(vehicle_pose(0.0));
+
+    double poseTime = 0.0;
+    std::chrono::steady_clock::duration elapsed(0);
+    for(unsigned int angle = 0; angle < 400; angle++) {
+        double t = 0.025*angle;
+        auto ping = make_ping(angle, t);
+        auto t0 = std::chrono::steady_clock::now();
+        while(poseTime + 0.1 <= t) {
+            live.add_pose(vehicle_pose(poseTime));
+            poseTime += 0.05;
+        }
+        live.add_row(ping, t);
+        elapsed += std::chrono::steady_clock::now() - t0;
+        offline.add_row(ping, t);
+        fixed.add_row(ping, 0.0);
+    }
+    while(poseTime <= 11.0) {
+        live.add_pose(vehicle_pose(poseTime));
+        poseTime += 0.05;
+    }
+
+    auto stats = live.statistics();
+    cout << "Live : " << stats.placedCount << " rows placed, " << stats.droppedCount
+         << " dropped, " << stats.pointCount / stats.placedCount << " points per row, "
+         << std::chrono::duration<double, std::micro>(elapsed).count() / 400
+         << " us per row" << endl;
+
+    bool same = std::equal(live.sums(), live.sums() + live.width()*live.height(),
+                           offline.sums());
+    cout << "Live and file poses give the same grid : " << same << endl
+         << "Bright cells distance to targets : compensated " << spread(live)
+         << " m, uncompensated " << spread(fixed) << " m" << endl;
+
+    std::vector<uint8_t> image;
+    live.image(image);
+    std::ofstream f("motion_compensation01.pgm", std::ios::binary);
+    f << "P5\n" << live.width() << ' ' << live.height() << "\n255\n";
+    f.write((const char*)image.data(), image.size());
+
+    return 0;
+}
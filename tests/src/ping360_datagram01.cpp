@@ -0,0 +1,28 @@
+#include <iostream>
+using namespace std;
+
+#include <ping_protocol/PingClient.h>
+#include <ping_protocol/messages/Ping360Messages.h>
+using namespace ping_protocol;
+
+int main()
+{
+    auto client = PingClient::CreateUDPDatagram("192.168.2.2", 9092);
+
+    getchar();
+
+    for(int i = 0; i < 10; i++) {
+        client->send(ping360::Transducer());
+        getchar();
+        client->send(ping360::MotorOff());
+        getchar();
+    }
+
+    auto stats = client->datagram_socket()->statistics();
+    cout << "syscalls  : " << stats.syscalls  << endl
+         << "datagrams : " << stats.datagrams << endl
+         << "frames    : " << stats.frames    << endl
+         << "truncated : " << stats.truncated << endl;
+
+    return 0;
+}
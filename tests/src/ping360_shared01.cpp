@@ -0,0 +1,56 @@
+#include <iostream>
+using namespace std;
+
+#include <ping_protocol/PingClient.h>
+#include <ping_protocol/SharedPublisher.h>
+#include <ping_protocol/messages/Ping360Messages.h>
+#include <ping_protocol/ping360/Sweep.h>
+using namespace ping_protocol;
+
+class SharedClient : public PingClient
+{
+    protected:
+
+    SharedPublisher::Ptr     publisher_;
+    mutable ping360::SweepAssembler assembler_;
+
+    public:
+
+    SharedClient(rtac::asio::Stream::Ptr stream, SharedPublisher::Ptr publisher) :
+        PingClient(stream),
+        publisher_(publisher),
+        assembler_([publisher](const ping360::Sweep& sweep) {
+            publisher->publish(sweep);
+        })
+    {}
+
+    ~SharedClient() { this->stop(); }
+
+    void message_callback(const Message& msg) const
+    {
+        publisher_->publish(msg);
+        if(msg.header().message_id == ping360::DeviceData::MessageId) {
+            assembler_.add_row(reinterpret_cast<const ping360::DeviceData&>(msg));
+        }
+    }
+};
+
+int main()
+{
+    auto publisher = SharedPublisher::Create("/ping360_shared01");
+    SharedClient client(rtac::asio::Stream::CreateSerial("/dev/ttyUSB1", 2000000),
+                        publisher);
+    client.start();
+
+    getchar();
+
+    for(int i = 0; i < 10; i++) {
+        client.send(ping360::Transducer());
+        getchar();
+    }
+    client.send(ping360::MotorOff());
+
+    cout << "Published " << publisher->published_count() << " records." << endl;
+
+    return 0;
+}
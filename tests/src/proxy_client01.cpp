@@ -0,0 +1,26 @@
+#include <iostream>
+using namespace std;
+
+#include <ping_protocol/ProxyClient.h>
+#include <ping_protocol/messages/Ping360Messages.h>
+using namespace ping_protocol;
+
+// Needs a running ping_proxy. Several instances can be started at the same
+// time, the one with the highest priority gets the device.
+int main(int argc, char** argv)
+{
+    int priority = argc > 1 ? std::stoi(argv[1]) : 0;
+    auto client = ProxyClient::Create(DefaultProxySocket, priority);
+
+    getchar();
+
+    for(int i = 0; i < 10; i++) {
+        client->send(ping360::Transducer());
+        getchar();
+        client->send(ping360::MotorOff());
+        getchar();
+    }
+    client->release_lease();
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+using namespace std;
+
+#include <ping_protocol/ping360/ScanScheduler.h>
+using namespace ping_protocol;
+
+int main()
+{
+    ping360::ScanScheduler scheduler;
+
+    // Hot sector between angles 100 and 125, a contact is detected near
+    // angle 300 halfway through.
+    scheduler.set_priority(4, 1.0f);
+
+    // Simulated device at 50 pings per second.
+    auto t = ping360::ScanScheduler::Clock::now();
+    auto period = std::chrono::milliseconds(20);
+    for(unsigned int n = 0; n < 30000; n++) {
+        unsigned int angle = scheduler.next_angle(t);
+        if(n > 15000 && angle >= 295 && angle < 305) {
+            scheduler.raise_priority(angle, 0.2f);
+        }
+        t += period;
+    }
+
+    cout << "sector  angles    priority  step  passes  refresh(Hz)" << endl;
+    for(unsigned int n = 0; n < scheduler.sector_count(); n++) {
+        auto stats = scheduler.sector_stats(n);
+        cout << setw(6) << n
+             << setw(5) << stats.startAngle << '-' << setw(3) << stats.endAngle
+             << setw(10) << setprecision(3) << stats.priority
+             << setw(6)  << stats.step
+             << setw(8)  << stats.passCount
+             << setw(13) << setprecision(3) << stats.refreshRate << endl;
+    }
+
+    return 0;
+}
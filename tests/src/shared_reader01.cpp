@@ -0,0 +1,42 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+using namespace std;
+
+#include <ping_protocol/SharedReader.h>
+#include <ping_protocol/messages/print_utils.h>
+using namespace ping_protocol;
+
+int main()
+{
+    auto reader = SharedReader::Create("/ping360_shared01");
+
+    SharedRecordView view;
+    for(;;) {
+        if(!reader->next(view)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if(view.kind == RecordMessage) {
+            auto header = view.message_header();
+            if(!view.is_valid()) continue;
+            cout << "record " << view.index << " : message "
+                 << header.message_id << endl;
+        }
+        else if(view.kind == RecordSweep) {
+            auto header = view.sweep_header();
+            unsigned int sum = 0;
+            for(unsigned int n = 0; n < header.sample_count; n++) {
+                sum += view.sweep_row(0)[n];
+            }
+            if(!view.is_valid()) continue;
+            cout << "record " << view.index << " : sweep ("
+                 << header.row_count << " rows of "
+                 << header.sample_count << " samples, row 0 sum : "
+                 << sum << ')' << endl;
+        }
+        cout << "dropped : " << reader->dropped_count() << endl;
+    }
+
+    return 0;
+}
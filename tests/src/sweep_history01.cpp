@@ -0,0 +1,73 @@
+#include <iostream>
+#include <chrono>
+using namespace std;
+
+#include <ping_protocol/ping360/SweepHistory.h>
+using namespace ping_protocol;
+
+int main()
+{
+    auto config = ping360::SweepHistory::default_config();
+    config.hotCapacity  = 800;
+    config.coldCapacity = 4000;
+    auto history = ping360::SweepHistory::Create(config);
+    cout << "Memory usage : " << history->memory_usage() / 1024 << " kB" << endl;
+
+    ping360::DeviceData::Metadata meta;
+    std::memset(&meta, 0, sizeof(meta));
+    meta.sample_period     = 80;
+    meta.number_of_samples = 1200;
+    meta.data_length       = 1200;
+    std::vector<uint8_t> data(meta.data_length);
+
+    // 20 turns at 50 pings per second, samples encode the turn index.
+    auto t0 = ping360::SweepHistory::Clock::now();
+    auto period = std::chrono::milliseconds(20);
+    for(unsigned int n = 0; n < 8000; n++) {
+        meta.angle = n % 400;
+        std::fill(data.begin(), data.end(), 10*(n / 400));
+        history->insert(ping360::DeviceData(meta, data), t0 + n*period);
+    }
+    cout << "Stored rows : " << history->size() << endl;
+
+    ping360::SweepHistory::Row row;
+    history->latest(123, row);
+    cout << "Latest row at angle 123 : turn " << row.samples[0] / 10 << endl;
+
+    auto tq = t0 + 7999*period - std::chrono::seconds(30);
+    auto t1 = std::chrono::steady_clock::now();
+    unsigned int queryCount = 100000;
+    for(unsigned int n = 0; n < queryCount; n++) {
+        history->at(n % 400, tq, row);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    history->at(123, tq, row);
+    cout << "Angle 123 30s ago : value " << (int)row.samples[0]
+         << (row.cold ? " (cold)" : " (hot)") << ", "
+         << std::chrono::duration<double, std::nano>(t2 - t1).count() / queryCount
+         << " ns per query" << endl;
+
+    std::vector<ping360::SweepHistory::Row> rows;
+    history->query(tq, tq + std::chrono::seconds(1), rows, 120, 130);
+    cout << "Rows in 1s window, angles [120,130) : " << rows.size() << endl;
+
+    ping360::Sweep sweep;
+    std::vector<uint8_t> buffer;
+    unsigned int count = history->reconstruct(tq, std::chrono::seconds(8), sweep, buffer);
+    cout << "Reconstructed sweep : " << count << " rows, "
+         << sweep.sample_count() << " samples" << endl;
+
+    // Sector scan of 20 angles : the hot ring holds 200 rows per angle.
+    auto sector = ping360::SweepHistory::Create();
+    for(unsigned int n = 0; n < 10000; n++) {
+        meta.angle = n % 20;
+        std::fill(data.begin(), data.end(), n % 256);
+        sector->insert(ping360::DeviceData(meta, data), t0 + n*period);
+    }
+    sector->at(5, t0 + 6999*period, row);
+    cout << "Sector scan, angle 5 at ping 6999 : ping "
+         << (row.timestamp - t0) / period << (row.cold ? " (cold)" : " (hot)")
+         << ", expected 6985 (hot)" << endl;
+
+    return 0;
+}
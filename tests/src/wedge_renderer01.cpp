@@ -0,0 +1,43 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+using namespace std;
+
+#include <ping_protocol/ping360/WedgeRenderer.h>
+using namespace ping_protocol;
+
+int main()
+{
+    ping360::WedgeRenderer renderer(800, 2);
+
+    ping360::DeviceData::Metadata meta;
+    std::memset(&meta, 0, sizeof(meta));
+    meta.sample_period     = 80;
+    meta.number_of_samples = 1200;
+    meta.data_length       = 1200;
+
+    std::vector<uint8_t> data(meta.data_length);
+    for(unsigned int n = 0; n < data.size(); n++) {
+        data[n] = (n / 50) % 2 ? 255 : 64;
+    }
+
+    ping360::Rectangle dirty;
+    auto t0 = std::chrono::steady_clock::now();
+    for(unsigned int angle = 0; angle < 400; angle += renderer.angle_step()) {
+        meta.angle = angle;
+        dirty = renderer.render(ping360::DeviceData(meta, data));
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    cout << "Full sweep rendered in "
+         << std::chrono::duration<double, std::milli>(t1 - t0).count() << "ms" << endl
+         << "Last dirty rectangle : " << dirty.left << ' ' << dirty.top << ' '
+         << dirty.width() << 'x' << dirty.height() << endl
+         << "Resolution : " << renderer.resolution() << "m/pixel" << endl;
+
+    std::ofstream f("wedge_renderer01.pgm", std::ios::binary);
+    f << "P5\n" << renderer.width() << ' ' << renderer.width() << "\n255\n";
+    f.write((const char*)renderer.image(), renderer.width()*renderer.width());
+
+    return 0;
+}
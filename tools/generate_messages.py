@@ -0,0 +1,276 @@
+#!/usr/bin/env python3
+"""
+Generates C++ message views from ping-protocol JSON definition files.
+
+usage : generate_messages.py <definition.json> <output.h>
+
+For each message the generated header contains a view class with the
+message id, the packed layout of the fixed part of the payload, little-endian
+field accessors, a validate() function and a set() function to write the
+fields in place. Accessors read at offsetof(Layout, field) : the layout is the
+only source of offsets in the generated code, and static_asserts check it
+against the wire offsets given by the field types of the JSON definition. Each
+file also gets a dispatch() function which switches on the message id and
+calls a visitor with the matching view.
+
+The generated layouts are also checked against the hand-written messages in
+include/ping_protocol/messages/generated_layouts.h.
+"""
+
+import json
+import os
+import sys
+
+TYPES = {
+    'u8':    ('uint8_t',  1),
+    'u16':   ('uint16_t', 2),
+    'u32':   ('uint32_t', 4),
+    'i8':    ('int8_t',   1),
+    'i16':   ('int16_t',  2),
+    'i32':   ('int32_t',  4),
+    'float': ('float',    4),
+}
+
+
+def camel_case(name):
+    return ''.join(part.capitalize() for part in name.split('_'))
+
+
+def comment(text, indent):
+    # keeps generated comments on one line
+    return indent + '// ' + ' '.join(text.split()) + '\n' if text else ''
+
+
+class Field:
+
+    def __init__(self, desc, offset):
+        self.name        = desc['name']
+        self.description = desc.get('description', '')
+        self.kind        = desc['type']
+        self.offset      = offset
+        if self.kind in TYPES:
+            self.ctype, self.size = TYPES[self.kind]
+        elif self.kind == 'vector':
+            vector = desc['vector']
+            self.ctype, self.size = TYPES[vector['sizetype']]
+            self.itemType, self.itemSize = TYPES[vector['datatype']]
+        elif self.kind == 'char[]':
+            self.ctype, self.size = None, 0
+        else:
+            raise ValueError("Unknown field type '%s' for field '%s'"
+                             % (self.kind, self.name))
+
+
+class MessageDef:
+
+    def __init__(self, name, category, desc):
+        self.name        = name
+        self.className   = camel_case(name)
+        self.category    = category
+        self.id          = desc['id']
+        self.description = desc.get('description', '')
+        self.fields      = []
+        self.tail        = None # variable size field, always last
+        offset = 0
+        for fieldDesc in desc.get('payload', []):
+            if self.tail is not None:
+                raise ValueError("Message '%s' : variable size field '%s' is not last"
+                                 % (name, self.tail.name))
+            field = Field(fieldDesc, offset)
+            if field.kind in TYPES:
+                self.fields.append(field)
+            else:
+                self.tail = field
+            offset += field.size
+        self.fixedSize = offset
+
+    def generate(self, device):
+        cls = self.className
+        out = comment(self.description, '')
+        out += 'struct %s\n{\n' % cls
+
+        # packed layout of the fixed part of the payload
+        out += '    #pragma pack(push, 1)\n'
+        out += '    struct Layout {\n'
+        for f in self.fields:
+            out += '        %-8s %s;\n' % (f.ctype, f.name)
+        if self.tail is not None and self.tail.kind == 'vector':
+            out += '        %-8s %s_length;\n' % (self.tail.ctype, self.tail.name)
+        if self.fixedSize == 0:
+            out += '        // empty payload\n'
+        out += '    };\n'
+        out += '    #pragma pack(pop)\n\n'
+
+        out += '    static constexpr uint16_t    MessageId        = %d;\n' % self.id
+        out += '    static constexpr const char* Name             = "%s::%s";\n' % (device, self.name)
+        # an empty struct has a size of 1
+        out += '    static constexpr std::size_t PayloadFixedSize = %s;\n' % (
+            'sizeof(Layout)' if self.fixedSize > 0 else '0')
+        out += '    static constexpr bool        IsFixedSize      = %s;\n' % (
+            'true' if self.tail is None else 'false')
+        out += '    // frame size, same convention as the hand-written messages\n'
+        out += '    static constexpr int         FixedSize        = %s;\n\n' % (
+            'sizeof(MessageHeader) + PayloadFixedSize + 2' if self.tail is None else '-1')
+
+        # The accessors only use the layout, checking it against the wire
+        # format of the definition file.
+        out += '    static_assert(PayloadFixedSize == %d, "%s : payload size differs from the definition");\n' % (
+            self.fixedSize, cls)
+        for f in self.fields:
+            out += '    static_assert(offsetof(Layout, %s) == %d && sizeof(Layout::%s) == %d,\n' % (
+                f.name, f.offset, f.name, f.size)
+            out += '                  "%s : %s differs from the definition");\n' % (cls, f.name)
+        if self.tail is not None and self.tail.kind == 'vector':
+            t = self.tail
+            out += '    static_assert(offsetof(Layout, %s_length) == %d && sizeof(Layout::%s_length) == %d,\n' % (
+                t.name, t.offset, t.name, t.size)
+            out += '                  "%s : %s_length differs from the definition");\n' % (cls, t.name)
+        out += '\n'
+
+        out += '    const uint8_t* frame_;\n\n'
+        out += '    explicit %s(const uint8_t* frame) : frame_(frame) {}\n' % cls
+        out += '    explicit %s(const Message& msg)   : frame_(msg.data()) {}\n\n' % cls
+        out += '    const MessageHeader& header() const {\n'
+        out += '        return *reinterpret_cast<const MessageHeader*>(frame_);\n'
+        out += '    }\n'
+        out += '    const uint8_t* payload() const { return frame_ + sizeof(MessageHeader); }\n'
+        out += '    uint16_t payload_length() const { return load_le<uint16_t>(frame_ + 2); }\n\n'
+
+        for f in self.fields:
+            out += comment(f.description, '    ')
+            out += '    %s %s() const { return load_le<%s>(this->payload() + offsetof(Layout, %s)); }\n' % (
+                f.ctype, f.name, f.ctype, f.name)
+        if self.tail is not None:
+            t = self.tail
+            out += comment(t.description, '    ')
+            if t.kind == 'vector':
+                out += '    %s %s_length() const {\n' % (t.ctype, t.name)
+                out += '        return load_le<%s>(this->payload() + offsetof(Layout, %s_length));\n' % (
+                    t.ctype, t.name)
+                out += '    }\n'
+                if t.itemSize == 1:
+                    out += '    const %s* %s() const {\n' % (t.itemType, t.name)
+                    out += '        return reinterpret_cast<const %s*>(this->payload() + PayloadFixedSize);\n' % (
+                        t.itemType)
+                    out += '    }\n'
+                else:
+                    out += '    %s %s(std::size_t index) const {\n' % (t.itemType, t.name)
+                    out += '        return load_le<%s>(this->payload() + PayloadFixedSize + %d*index);\n' % (
+                        t.itemType, t.itemSize)
+                    out += '    }\n'
+            else:
+                out += '    const char* %s() const {\n' % t.name
+                out += '        return reinterpret_cast<const char*>(this->payload() + PayloadFixedSize);\n'
+                out += '    }\n'
+                out += '    std::size_t %s_length() const {\n' % t.name
+                out += '        return this->payload_length() - PayloadFixedSize;\n'
+                out += '    }\n'
+        out += '\n'
+
+        # validation, on raw frame bytes
+        out += '    // Checks id, payload length and checksum of [frame, frame + size).\n'
+        out += '    static bool validate(const uint8_t* frame, std::size_t size) {\n'
+        out += '        if(size < sizeof(MessageHeader) + 2 || frame[0] != \'B\' || frame[1] != \'R\')\n'
+        out += '            return false;\n'
+        out += '        if(load_le<uint16_t>(frame + 4) != MessageId)\n'
+        out += '            return false;\n'
+        out += '        uint16_t payloadLength = load_le<uint16_t>(frame + 2);\n'
+        out += '        if(size < sizeof(MessageHeader) + payloadLength + 2)\n'
+        out += '            return false;\n'
+        if self.tail is None:
+            out += '        if(payloadLength != PayloadFixedSize)\n'
+            out += '            return false;\n'
+        else:
+            out += '        if(payloadLength < PayloadFixedSize)\n'
+            out += '            return false;\n'
+            if self.tail.kind == 'vector':
+                out += '        std::size_t itemCount = load_le<%s>(\n' % self.tail.ctype
+                out += '            frame + sizeof(MessageHeader) + offsetof(Layout, %s_length));\n' % self.tail.name
+                out += '        if(PayloadFixedSize + %d*itemCount > payloadLength)\n' % self.tail.itemSize
+                out += '            return false;\n'
+        out += '        return load_le<uint16_t>(frame + sizeof(MessageHeader) + payloadLength)\n'
+        out += '            == compute_checksum(frame);\n'
+        out += '    }\n'
+
+        # in place writer for the fixed fields
+        if self.fields:
+            args = ', '.join('%s %s' % (f.ctype, f.name) for f in self.fields)
+            out += '\n    // Writes the fixed fields in a payload (checksum not updated).\n'
+            out += '    static void set(uint8_t* payload, %s) {\n' % args
+            for f in self.fields:
+                out += '        store_le<%s>(payload + offsetof(Layout, %s), %s);\n' % (f.ctype, f.name, f.name)
+            out += '    }\n'
+        out += '};\n\n'
+        return out
+
+
+def load_messages(path):
+    with open(path) as f:
+        definition = json.load(f)
+    messages = []
+    for category, entries in definition['messages'].items():
+        for name, desc in entries.items():
+            messages.append(MessageDef(name, category, desc))
+    messages.sort(key=lambda m: m.id)
+    ids = [m.id for m in messages]
+    if len(ids) != len(set(ids)):
+        raise ValueError("Duplicate message ids in %s" % path)
+    return messages
+
+
+def generate(path, output):
+    device   = os.path.splitext(os.path.basename(path))[0]
+    messages = load_messages(path)
+    guard    = '_DEF_PING_PROTOCOL_GENERATED_%s_H_' % device.upper()
+
+    out  = '// Generated by tools/generate_messages.py from %s. Do not edit.\n' % os.path.basename(path)
+    out += '#ifndef %s\n#define %s\n\n' % (guard, guard)
+    out += '#include <cstddef>\n#include <cstdint>\n\n'
+    out += '#include <ping_protocol/messages/MessageBase.h>\n'
+    out += '#include <ping_protocol/messages/endian.h>\n\n'
+    out += 'namespace ping_protocol { namespace generated { namespace %s {\n\n' % device
+    for m in messages:
+        out += m.generate(device)
+
+    out += 'constexpr uint16_t MessageIds[] = {\n'
+    out += ''.join('    %s::MessageId,\n' % m.className for m in messages)
+    out += '};\n\n'
+
+    out += '/**\n'
+    out += ' * Validates the frame [frame, frame + size) and calls visitor with the\n'
+    out += ' * matching view. Returns false if the message id is not part of this\n'
+    out += ' * definition file or if the frame is not valid.\n'
+    out += ' */\n'
+    out += 'template <class Visitor>\n'
+    out += 'inline bool dispatch(const uint8_t* frame, std::size_t size, Visitor&& visitor)\n'
+    out += '{\n'
+    out += '    if(size < sizeof(MessageHeader))\n'
+    out += '        return false;\n'
+    out += '    switch(load_le<uint16_t>(frame + 4)) {\n'
+    out += '        default: return false;\n'
+    for m in messages:
+        out += '        case %s::MessageId:\n' % m.className
+        out += '            if(!%s::validate(frame, size)) return false;\n' % m.className
+        out += '            visitor(%s(frame));\n' % m.className
+        out += '            return true;\n'
+    out += '    }\n'
+    out += '}\n\n'
+    out += '} //namespace %s\n} //namespace generated\n} //namespace ping_protocol\n\n' % device
+    out += '#endif //%s\n' % guard
+
+    os.makedirs(os.path.dirname(os.path.abspath(output)), exist_ok=True)
+    # always written : the output must be newer than its dependencies or the
+    # build runs the generator again every time
+    with open(output, 'w') as f:
+        f.write(out)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        sys.stderr.write('usage : %s <definition.json> <output.h>\n' % sys.argv[0])
+        sys.exit(1)
+    try:
+        generate(sys.argv[1], sys.argv[2])
+    except (ValueError, KeyError) as e:
+        sys.stderr.write('%s : %s\n' % (sys.argv[1], e))
+        sys.exit(1)